@@ -109,7 +109,8 @@ const qv_scope_flags_t QV_SCOPE_FLAG_NO_SMT         = (1LL << 0);
 const qv_scope_flags_t QV_SCOPE_FLAG_HINT_CLOSE     = (1LL << 1);
 
 /**
- *
+ * Reserve the resources of a created scope until it is freed, so that they
+ * are not handed to other exclusive scopes on the node in the meantime.
  */
 const qv_scope_flags_t QV_SCOPE_FLAG_HINT_EXCLUSIVE = (1LL << 2);
 
@@ -54,8 +54,9 @@ struct qvid {
             // Not RLIM_INFINITY, so set to resource limit.
             maxfd = (int64_t)rl.rlim_max;
         }
-        // Close all the file descriptors.
+        // Close all the file descriptors, except the one we notify once ready.
         for (int64_t fd = 0; fd < maxfd; ++fd) {
+            if (fd == rmic.ready_fd) continue;
             (void)close(fd);
         }
     }
@@ -97,6 +98,7 @@ struct qvid {
 
         qvi_log_info("--URL: {}", rmic.url);
         qvi_log_info("--Port Number: {}", rmic.portno);
+        qvi_log_info("--Number of Workers: {}", rmic.nworkers);
     }
 
     void
@@ -153,9 +155,7 @@ struct qvid {
             );
         }
         // Determine if we have to create a session directory.
-        const std::string portnos = std::to_string(rmic.portno);
-        const std::string session_dirname = app_name + "." + portnos;
-        const std::string full_session_dir = tmpdir + "/" + session_dirname;
+        const std::string full_session_dir = qvi_session_dir(rmic.portno);
         const bool sdir_exists = qvi_access(full_session_dir, R_OK | W_OK, &eno);
         if (!sdir_exists) {
             const int rc = mkdir(full_session_dir.c_str(), 0755);
@@ -243,7 +243,9 @@ parse_args(
     enum {
         FLOOR = 256,
         NO_DAEMONIZE,
-        PORT
+        PORT,
+        READY_FD,
+        WORKERS
     };
 
     const cstr_t opts = "Vh";
@@ -252,13 +254,17 @@ parse_args(
         {"version"         , no_argument,       nullptr, 'V'                  },
         {"no-daemonize"    , no_argument,       nullptr, NO_DAEMONIZE         },
         {"port"            , required_argument, nullptr, PORT                 },
+        {"ready-fd"        , required_argument, nullptr, READY_FD             },
+        {"workers"         , required_argument, nullptr, WORKERS              },
         {nullptr           , 0,                 nullptr, 0                    }
     };
     static const option_help opt_help = {
         {"[-h, --help]         ", "Show this message and exit."               },
         {"[-V, --version]      ", "Display version information and exit."     },
         {"[--no-daemonize]     ", "Do not run as a daemon."                   },
-        {"[--port PORTNO]      ", "Specify port number to use."               }
+        {"[--port PORTNO]      ", "Specify port number to use."               },
+        {"[--ready-fd FD]      ", "Write a byte to FD once ready, then close."},
+        {"[--workers N]        ", "Specify number of RPC worker threads."     }
     };
 
     int opt;
@@ -283,6 +289,26 @@ parse_args(
                 }
                 break;
             }
+            case READY_FD: {
+                const int fd = qvi_stoi(std::string(optarg));
+                if (fd < 0) {
+                    qvi_log_info("ready fd {} is out of range.", fd);
+                    return QV_ERR_INVLD_ARG;
+                }
+                qvd.rmic.ready_fd = fd;
+                break;
+            }
+            case WORKERS: {
+                const int nworkers = qvi_stoi(std::string(optarg));
+                if (nworkers <= 0) {
+                    qvi_log_info(
+                        "number of workers {} is out of range.", nworkers
+                    );
+                    return QV_ERR_INVLD_ARG;
+                }
+                qvd.rmic.nworkers = size_t(nworkers);
+                break;
+            }
             default:
                 show_usage(opt_help);
                 return QV_ERR_INVLD_ARG;
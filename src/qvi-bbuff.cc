@@ -1,6 +1,6 @@
 /* -*- Mode: C++; c-basic-offset:4; indent-tabs-mode:nil -*- */
 /*
- * Copyright (c) 2020-2025 Triad National Security, LLC
+ * Copyright (c) 2020-2026 Triad National Security, LLC
  *                         All rights reserved.
  *
  * Copyright (c) 2020-2021 Lawrence Livermore National Security, LLC
@@ -78,23 +78,41 @@ qvi_bbuff::cdata(void) const
     return m_data;
 }
 
+int
+qvi_bbuff::m_reserve(
+    size_t capacity
+) {
+    if (capacity <= m_capacity) return QV_SUCCESS;
+    // Grow geometrically to amortize the cost of repeated appends.
+    const size_t new_capacity = std::max(
+        capacity, std::max(2 * m_capacity, m_capacity + s_min_growth)
+    );
+    void *new_data = realloc(m_data, new_capacity);
+    if (qvi_unlikely(!new_data)) return QV_ERR_OOR;
+    // Memory allocation successful.
+    m_capacity = new_capacity;
+    m_data = new_data;
+    return QV_SUCCESS;
+}
+
+int
+qvi_bbuff::resize(
+    size_t size
+) {
+    const int rc = m_reserve(size);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    m_size = size;
+    return QV_SUCCESS;
+}
+
 int
 qvi_bbuff::append(
     const void *const data,
     size_t size
 ) {
-    const size_t req_capacity = size + m_size;
-    if (req_capacity > m_capacity) {
-        // New capacity.
-        const size_t new_capacity = req_capacity + s_min_growth;
-        void *new_data = calloc(new_capacity, sizeof(byte_t));
-        if (qvi_unlikely(!new_data)) return QV_ERR_OOR;
-        // Memory allocation successful.
-        memmove(new_data, m_data, m_size);
-        free(m_data);
-        m_capacity = new_capacity;
-        m_data = new_data;
-    }
+    const int rc = m_reserve(size + m_size);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
     byte_t *dest = (byte_t *)m_data;
     dest += m_size;
     memmove(dest, data, size);
@@ -102,6 +120,30 @@ qvi_bbuff::append(
     return QV_SUCCESS;
 }
 
+qvi_bbuff_ostreambuf::int_type
+qvi_bbuff_ostreambuf::overflow(
+    int_type ch
+) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    const char c = traits_type::to_char_type(ch);
+    const int rc = m_bbuff.append(&c, 1);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return traits_type::eof();
+    return ch;
+}
+
+std::streamsize
+qvi_bbuff_ostreambuf::xsputn(
+    const char *s,
+    std::streamsize n
+) {
+    // A short write makes the stream (and therefore cereal) report an error.
+    const int rc = m_bbuff.append(s, n);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return 0;
+    return n;
+}
+
 /*
  * vim: ft=cpp ts=4 sts=4 sw=4 expandtab
  */
@@ -1,6 +1,6 @@
 /* -*- Mode: C++; c-basic-offset:4; indent-tabs-mode:nil -*- */
 /*
- * Copyright (c) 2020-2025 Triad National Security, LLC
+ * Copyright (c) 2020-2026 Triad National Security, LLC
  *                         All rights reserved.
  *
  * Copyright (c) 2020-2021 Lawrence Livermore National Security, LLC
@@ -29,6 +29,49 @@
 #include "cereal/types/vector.hpp"
 // IWYU pragma: end_keep
 
+struct qvi_bbuff;
+
+/**
+ * Output stream buffer that appends directly to a byte buffer, so that
+ * serialized data need not be staged in an intermediate buffer first.
+ */
+struct qvi_bbuff_ostreambuf : public std::streambuf {
+private:
+    /** The byte buffer we are appending to. */
+    qvi_bbuff &m_bbuff;
+protected:
+    /** Appends a single character. */
+    virtual int_type
+    overflow(
+        int_type ch
+    ) override;
+    /** Appends n characters. */
+    virtual std::streamsize
+    xsputn(
+        const char *s,
+        std::streamsize n
+    ) override;
+public:
+    /** Constructor. */
+    explicit qvi_bbuff_ostreambuf(
+        qvi_bbuff &bbuff
+    ) : m_bbuff(bbuff) { }
+};
+
+/**
+ * Input stream buffer that reads in place from a contiguous range of bytes.
+ */
+struct qvi_bbuff_istreambuf : public std::streambuf {
+    /** Constructor. */
+    qvi_bbuff_istreambuf(
+        const void *data,
+        size_t size
+    ) {
+        char *const base = static_cast<char *>(const_cast<void *>(data));
+        setg(base, base, base + size);
+    }
+};
+
 struct qvi_bbuff {
 private:
     /** Minimum growth in bytes for resizes, etc. */
@@ -41,6 +84,11 @@ private:
     void *m_data = nullptr;
     /** Initializes the instance. */
     void m_init(void);
+    /** Ensures that the buffer can hold at least the requested capacity. */
+    int
+    m_reserve(
+        size_t capacity
+    );
 public:
     /** Constructor. */
     qvi_bbuff(void);
@@ -56,6 +104,15 @@ public:
     /** Returns the size of the data stored in the byte buffer. */
     size_t
     size(void) const;
+    /**
+     * Resizes the buffer to hold exactly size bytes. Existing contents are
+     * preserved up to the new size; new contents are unspecified. Useful for
+     * receiving data directly into the buffer.
+     */
+    int
+    resize(
+        size_t size
+    );
     /** Appends data to the buffer. */
     int
     append(
@@ -75,7 +132,8 @@ public:
     const void *
     cdata(void) const;
     /**
-     *
+     * Serializes the provided arguments directly into the buffer, prefixed by
+     * the length of the resulting archive.
      */
     template<typename ...Types>
     int
@@ -83,41 +141,48 @@ public:
         Types &&...args
     ) {
         try {
-            std::stringstream ss;
+            // Reserve room for the archive length, known only once we're done.
+            const size_t len_pos = m_size;
+            size_t len = 0;
+            const int rc = append(&len, sizeof(len));
+            if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
             // Scoped to force flush on destruct.
             {
-                cereal::BinaryOutputArchive oarchive(ss);
+                qvi_bbuff_ostreambuf sbuf(*this);
+                std::ostream os(&sbuf);
+                cereal::BinaryOutputArchive oarchive(os);
                 // Use a fold expression to serialize each argument.
                 (oarchive(std::forward<Types>(args)), ...);
             }
-
-            const std::string archives(ss.str());
-            const size_t len = archives.length();
-
-            const int rc = append(&len, sizeof(size_t));
-            if (qvi_unlikely(rc) != QV_SUCCESS) return rc;
-            return append(archives.data(), archives.size());
+            len = m_size - len_pos - sizeof(len);
+            memcpy(static_cast<byte_t *>(m_data) + len_pos, &len, sizeof(len));
+            return QV_SUCCESS;
         }
         qvi_catch_and_return();
     }
-
+    /**
+     * Deserializes into the provided arguments data previously serialized by
+     * pack(). Data are read in place, so data may point directly into, for
+     * example, a received message.
+     */
     template<typename ...Types>
     static int
     unpack(
-        void *data,
+        const void *data,
         Types &&...args
     ) {
         try {
-            byte_t *pos = static_cast<byte_t *>(data);
+            const byte_t *pos = static_cast<const byte_t *>(data);
 
             size_t slen;
-            memmove(&slen, pos, sizeof(slen));
+            memcpy(&slen, pos, sizeof(slen));
             pos += sizeof(slen);
 
-            std::stringstream ss(std::string((const char *)pos, slen));
+            qvi_bbuff_istreambuf sbuf(pos, slen);
+            std::istream is(&sbuf);
             // Scoped to force flush on destruct.
             {
-                cereal::BinaryInputArchive iarchive(ss);
+                cereal::BinaryInputArchive iarchive(is);
                 iarchive(std::forward<Types>(args)...);
             }
 
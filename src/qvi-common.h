@@ -31,6 +31,7 @@
 #include <getopt.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -38,17 +39,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <sys/utsname.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #ifdef __cplusplus
 #include "qvi-log.h"
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <chrono>
 #include <csignal>
 #include <filesystem>
@@ -64,9 +74,11 @@
 #include <ranges>
 #include <regex>
 #include <set>
+#include <shared_mutex>
 #include <stack>
 #include <stdexcept>
 #include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -100,6 +112,10 @@ static const std::string QVI_ENV_TMPDIR = "QV_TMPDIR";
 static const std::string QVI_ENV_VEXCEPT = "QV_VEXCEPT";
 /** Verbose mapping environment variable name. */
 static const std::string QVI_ENV_VMAP = "QV_VMAP";
+/**
+ * Environment variable naming a directory under which the server looks for the
+ * sysfs and cgroup files it watches, in place of /.
+ */
 
 /**
  * Quo Vadis runtime error.
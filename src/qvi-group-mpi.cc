@@ -16,6 +16,8 @@
 
 #include "qvi-group-mpi.h"
 #include "qvi-task.h"
+#include "qvi-rmi.h"
+#include "qvi-hwpool.h"
 #include "qvi-utils.h"
 
 qvi_group_mpi::qvi_group_mpi(
@@ -74,6 +76,85 @@ qvi_group_mpi::make_intrinsic(
     );
 }
 
+/**
+ * Asks the server for the intrinsic hardware pools of the provided node-local
+ * processes, in node rank order, in a single round trip.
+ */
+static int
+node_intrinsic_hwpools(
+    qvi_rmi_client &rmi,
+    const std::vector<pid_t> &node_pids,
+    qv_scope_intrinsic_t intrinsic,
+    qv_scope_flags_t flags,
+    std::vector<qvi_hwpool> &hwpools
+) {
+    const size_t npids = node_pids.size();
+    hwpools.resize(npids);
+    // Process pools differ, since they follow each process' binding.
+    if (intrinsic == QV_SCOPE_PROCESS) {
+        qvi_rmi_batch batch(rmi);
+        for (size_t i = 0; i < npids; ++i) {
+            const int rc = batch.get_intrinsic_hwpool(
+                {node_pids[i]}, intrinsic, flags, hwpools[i]
+            );
+            if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+        }
+        return batch.execute();
+    }
+    // The others are shared by the whole node.
+    const int rc = rmi.get_intrinsic_hwpool(
+        node_pids, intrinsic, flags, hwpools[0]
+    );
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    std::fill(hwpools.begin() + 1, hwpools.end(), hwpools[0]);
+    return QV_SUCCESS;
+}
+
+int
+qvi_group_mpi::intrinsic_hwpool(
+    qv_scope_intrinsic_t intrinsic,
+    qv_scope_flags_t flags,
+    qvi_hwpool &hwpool
+) {
+    qvi_mpi_group node;
+    int rc = m_mpi->group_from_group_id(QVI_MPI_GROUP_NODE, node);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+    const std::vector<pid_t> node_pids = node.pids();
+    // The leader's return code goes along with every hardware pool, so that
+    // all members fail together. The other members wait in the scatter, so
+    // the leader must get there no matter what.
+    std::vector<qvi_bbuff> txbuffs;
+    if (node.rank() == 0) {
+        std::vector<qvi_hwpool> hwpools;
+        int qrc = node_intrinsic_hwpools(
+            m_task.rmi(), node_pids, intrinsic, flags, hwpools
+        );
+        txbuffs.resize(node_pids.size());
+        for (size_t i = 0; i < txbuffs.size() && qrc == QV_SUCCESS; ++i) {
+            qrc = txbuffs[i].pack(QV_SUCCESS, hwpools[i]);
+        }
+        if (qvi_unlikely(qrc != QV_SUCCESS)) {
+            for (auto &txbuff : txbuffs) {
+                // Should this fail too, the empty buffer signals the failure.
+                (void)txbuff.resize(0);
+                if (txbuff.pack(qrc, qvi_hwpool()) != QV_SUCCESS) {
+                    (void)txbuff.resize(0);
+                }
+            }
+        }
+    }
+    qvi_bbuff rxbuff;
+    rc = node.scatter_bbuffs(txbuffs, 0, rxbuff);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    if (qvi_unlikely(rxbuff.size() == 0)) return QV_ERR_INTERNAL;
+
+    int qrc = QV_SUCCESS;
+    rc = qvi_bbuff::unpack(rxbuff.data(), qrc, hwpool);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return qrc;
+}
+
 int
 qvi_group_mpi::self(
     qvi_group **child
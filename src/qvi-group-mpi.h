@@ -83,6 +83,16 @@ public:
         qv_scope_intrinsic_t intrinsic,
         qv_scope_flags_t flags
     );
+    /**
+     * Only the node leader asks the server, once for all the processes on the
+     * node, then hands each its hardware pool.
+     */
+    virtual int
+    intrinsic_hwpool(
+        qv_scope_intrinsic_t intrinsic,
+        qv_scope_flags_t flags,
+        qvi_hwpool &hwpool
+    );
 
     virtual int
     self(
@@ -13,15 +13,28 @@
 
 #include "qvi-group.h"
 #include "qvi-group-thread.h"
+#include "qvi-rmi.h"
+#include "qvi-task.h"
 #include "qvi-utils.h"
 
-qvi_hwloc &
+std::shared_ptr<qvi_hwloc>
 qvi_group::hwloc(void)
 {
     // Remember that task() is polymorphic.
     return task().hwloc();
 }
 
+int
+qvi_group::intrinsic_hwpool(
+    qv_scope_intrinsic_t intrinsic,
+    qv_scope_flags_t flags,
+    qvi_hwpool &hwpool
+) {
+    return task().rmi().get_intrinsic_hwpool(
+        pids(), intrinsic, flags, hwpool
+    );
+}
+
 int
 qvi_group::thread_split(
     int nthreads,
@@ -40,8 +40,8 @@ public:
     ) : m_flags(flags) { }
     /** Virtual destructor. */
     virtual ~qvi_group(void) = default;
-    /** Returns a reference to the task's hwloc information. */
-    qvi_hwloc &
+    /** Returns the task's hwloc information. */
+    std::shared_ptr<qvi_hwloc>
     hwloc(void);
     /** Returns a reference to the caller's task information. */
     virtual qvi_task &
@@ -64,6 +64,17 @@ public:
         qv_scope_intrinsic_t intrinsic,
         qv_scope_flags_t flags
     ) = 0;
+    /**
+     * Returns the caller's hardware pool for the provided intrinsic scope,
+     * which this group was made by make_intrinsic(). Collective across the
+     * group. By default, every member asks the server on its own.
+     */
+    virtual int
+    intrinsic_hwpool(
+        qv_scope_intrinsic_t intrinsic,
+        qv_scope_flags_t flags,
+        qvi_hwpool &hwpool
+    );
     /**
      * Creates a new self group with a single member: the caller.
      * Returns the appropriate newly created child group to the caller.
@@ -17,6 +17,8 @@
 #include "qvi-hwloc.h"
 #include "qvi-utils.h"
 
+#include "hwloc/shmem.h"
+
 /**
  * Note: we don't honor environment variables such as CUDA_VISIBLE_DEVICES,
  * ROCR_VISIBLE_DEVICES, etc.
@@ -232,10 +234,26 @@ get_pci_info(
 static std::string
 topo_fname(
     const std::string &base,
-    qvi_hwloc_flags_t flags
+    qvi_hwloc_flags_t flags,
+    const std::string &ext = "xml"
 ) {
     return base + "/hwtopo." + std::to_string(getpid()) + "-"
-                + std::to_string(flags) + ".xml";
+                + std::to_string(flags) + "." + ext;
+}
+
+std::vector<std::string>
+qvi_hwloc::cgroup_cpuset_files(
+    const std::string &root,
+    bool mems
+) {
+    std::string cgroup = qvi_read_file("/proc/self/cpuset");
+    if (!cgroup.empty() && cgroup.back() == '\n') cgroup.pop_back();
+    if (cgroup == "/") cgroup.clear();
+
+    const std::string v2 = root + "/sys/fs/cgroup" + cgroup + "/cpuset.";
+    const std::string v1 = root + "/sys/fs/cgroup/cpuset" + cgroup + "/cpuset.";
+    if (mems) return {v2 + "mems.effective", v1 + "effective_mems"};
+    return {v2 + "cpus.effective", v1 + "effective_cpus"};
 }
 
 int
@@ -381,12 +399,38 @@ qvi_hwloc::bitmap_split(
     return rc;
 }
 
+/**
+ * Lazily loaded topology that includes the I/O objects left out of topologies
+ * loaded from this system.
+ */
+struct qvi_hwloc_io {
+    /** Flags of the topology we provide I/O objects for. */
+    qvi_hwloc_flags_t flags = QVI_HWLOC_FLAG_EMPTY;
+    /** Snapshot cache directory. Empty if snapshots are not used. */
+    std::string cache_dir;
+    /** Key under which snapshots are valid. */
+    std::string key;
+    /** Serializes loading. */
+    std::mutex mutex;
+    /** The topology, once loaded. Not modified after that. */
+    hwloc_topology_t topo = nullptr;
+    /** Destructor. */
+    ~qvi_hwloc_io(void)
+    {
+        if (topo) hwloc_topology_destroy(topo);
+    }
+    /** Loads the topology, if not already loaded. */
+    int
+    load(void);
+};
+
 qvi_hwloc::~qvi_hwloc(void)
 {
     if (m_topo) hwloc_topology_destroy(m_topo);
-    // Unlink the file if we exported it.
-    if (!(m_flags & QVI_HWLOC_FLAG_TOPO_XML)) {
-        unlink(m_topo_file.c_str());
+    // Unlink the files if we exported them.
+    if (!(m_flags & (QVI_HWLOC_FLAG_TOPO_XML | QVI_HWLOC_FLAG_TOPO_SHMEM))) {
+        if (!m_topo_file.empty()) unlink(m_topo_file.c_str());
+        if (!m_topo_shmem.path.empty()) unlink(m_topo_shmem.path.c_str());
     }
 }
 
@@ -426,14 +470,31 @@ qvi_hwloc::topology_init(
 int
 qvi_hwloc::topology_load(void)
 {
+    return m_topology_load(false);
+}
+
+int
+qvi_hwloc::m_topology_load(
+    bool from_snapshot
+) {
     int rc = QV_SUCCESS;
     cstr_t ers = nullptr;
+    // Topologies from files already reflect our flags and I/O objects.
+    const bool from_system =
+        !(m_flags & QVI_HWLOC_FLAG_TOPO_XML) && !from_snapshot;
     do {
         // Set flags that influence hwloc's behavior. Include resources that are
         // not allowed (e.g., by cgroups) in the base topology. We will have
         // functions that provide bitmap access to allowed and disallowed
         // resources depending on need, but we must load it all.
-        const uint_t hwloc_flags = HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED;
+        uint_t hwloc_flags = HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED;
+        // Topologies we load from XML are published by the server running on
+        // this node, so they describe this system. Saying so lets us use them
+        // for binding, which hwloc otherwise turns into a no-op. The same goes
+        // for the server's snapshots, which are only used on the same boot.
+        if (!from_system) {
+            hwloc_flags |= HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM;
+        }
         rc = hwloc_topology_set_flags(m_topo, hwloc_flags);
         if (qvi_unlikely(rc != 0)) {
             ers = "hwloc_topology_set_flags() failed";
@@ -450,11 +511,20 @@ qvi_hwloc::topology_load(void)
             break;
         }
 
-        rc = hwloc_topology_set_type_filter(
-            m_topo,
-            HWLOC_OBJ_OS_DEVICE,
-            HWLOC_TYPE_FILTER_KEEP_IMPORTANT
-        );
+        // PCI and OS device discovery is usually the slowest part of a load,
+        // so leave I/O objects out. They are loaded when devices are needed.
+        if (from_system) {
+            rc = hwloc_topology_set_io_types_filter(
+                m_topo, HWLOC_TYPE_FILTER_KEEP_NONE
+            );
+        }
+        else {
+            rc = hwloc_topology_set_type_filter(
+                m_topo,
+                HWLOC_OBJ_OS_DEVICE,
+                HWLOC_TYPE_FILTER_KEEP_IMPORTANT
+            );
+        }
         if (qvi_unlikely(rc != 0)) {
             ers = "hwloc_topology_set_type_filter() failed";
             rc = QV_ERR_HWLOC;
@@ -468,18 +538,17 @@ qvi_hwloc::topology_load(void)
             break;
         }
 
-        if (m_flags & QVI_HWLOC_FLAG_TOPO_NO_SMT &&
-            !(m_flags & QVI_HWLOC_FLAG_TOPO_XML)) {
+        if (m_flags & QVI_HWLOC_FLAG_TOPO_NO_SMT && from_system) {
             rc = m_disable_smt();
             if (qvi_unlikely(rc != QV_SUCCESS)) {
                 ers = "m_disable_smt() failed";
                 break;
             }
         }
-
-        rc = m_discover_devices();
-        if (qvi_unlikely(rc != QV_SUCCESS)) {
-            ers = "m_discover_devices() failed";
+        // Exported topologies carry their I/O objects. Snapshots do not.
+        if (!(m_flags & QVI_HWLOC_FLAG_TOPO_XML)) {
+            m_io = std::make_shared<qvi_hwloc_io>();
+            m_io->flags = m_flags;
         }
     } while (false);
 
@@ -489,6 +558,325 @@ qvi_hwloc::topology_load(void)
     return rc;
 }
 
+/**
+ * Returns the CPUs and memory nodes of the cgroup cpuset we run in, which
+ * determine the allowed resources hwloc records in the topology.
+ */
+static std::string
+cgroup_cpuset(void)
+{
+    std::string result = qvi_read_file("/proc/self/cpuset");
+    for (const bool mems : {false, true}) {
+        for (const auto &path : qvi_hwloc::cgroup_cpuset_files("", mems)) {
+            result += qvi_read_file(path);
+        }
+    }
+    return result;
+}
+
+/**
+ * Returns the key under which a topology snapshot of the provided type is
+ * valid: the topology only changes across reboots, kernel updates, CPU hotplug,
+ * and changes to the cgroup cpuset we run in. Returns an empty string if the
+ * key cannot be determined, in which case snapshots must not be used.
+ */
+static std::string
+topo_snapshot_key(
+    qvi_hwloc_flags_t flags
+) {
+    // hwloc may be told to describe something other than this system.
+    for (const cstr_t var : {
+        "HWLOC_XMLFILE", "HWLOC_SYNTHETIC",
+        "HWLOC_FSROOT", "HWLOC_COMPONENTS"
+    }) {
+        if (getenv(var)) return std::string();
+    }
+
+    const std::string boot_id =
+        qvi_read_file("/proc/sys/kernel/random/boot_id");
+    if (boot_id.empty()) return std::string();
+
+    struct utsname uts;
+    if (uname(&uts) != 0) return std::string();
+
+    return "version " + std::to_string(QVI_0xVERSION) + "\n"
+         + "hwloc " + std::to_string(hwloc_get_api_version()) + "\n"
+         + "flags " + std::to_string(flags) + "\n"
+         + "boot_id " + boot_id
+         + "kernel " + uts.sysname + " " + uts.release + " "
+         + uts.version + " " + uts.machine + "\n"
+         + "online " + qvi_read_file("/sys/devices/system/cpu/online")
+         + "cpuset " + cgroup_cpuset();
+}
+
+/**
+ * Returns the path of a topology snapshot file. Unlike exported topologies,
+ * snapshots outlive the server, so their names do not include its PID.
+ */
+static inline std::string
+topo_snapshot_fname(
+    const std::string &cache_dir,
+    qvi_hwloc_flags_t flags,
+    const std::string &ext
+) {
+    return cache_dir + "/hwtopo." + std::to_string(flags) + "." + ext;
+}
+
+/**
+ * Saves a snapshot of the provided topology under the provided key.
+ */
+static int
+topo_save_snapshot(
+    hwloc_topology_t topo,
+    const std::string &xml_path,
+    const std::string &key_path,
+    const std::string &key
+) {
+    char *topo_xml = nullptr;
+    int topo_xml_len = 0;
+    const int rc = hwloc_topology_export_xmlbuffer(
+        topo, &topo_xml, &topo_xml_len, 0
+    );
+    if (qvi_unlikely(rc == -1)) return QV_ERR_HWLOC;
+    // Invalidate the previous snapshot before replacing it.
+    (void)unlink(key_path.c_str());
+    int qvrc = qvi_write_file_atomic(xml_path, topo_xml, topo_xml_len);
+    hwloc_free_xmlbuffer(topo, topo_xml);
+    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
+    return qvi_write_file_atomic(key_path, key.c_str(), key.size());
+}
+
+int
+qvi_hwloc::m_topology_save_snapshot(
+    const std::string &cache_dir,
+    const std::string &key
+) {
+    return topo_save_snapshot(
+        m_topo,
+        topo_snapshot_fname(cache_dir, m_flags, "xml"),
+        topo_snapshot_fname(cache_dir, m_flags, "key"),
+        key
+    );
+}
+
+/**
+ * Loads a topology that includes I/O objects from this system or, if a path is
+ * provided, from a snapshot of it.
+ */
+static int
+io_topology_load(
+    const std::string &xml_path,
+    hwloc_topology_t *result
+) {
+    hwloc_topology_t topo = nullptr;
+    int rc = hwloc_topology_init(&topo);
+    if (qvi_unlikely(rc != 0)) return QV_ERR_HWLOC;
+
+    uint_t hwloc_flags = HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED;
+    if (!xml_path.empty()) {
+        hwloc_flags |= HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM;
+        rc = hwloc_topology_set_xml(topo, xml_path.c_str());
+    }
+    if (qvi_likely(rc == 0)) {
+        rc = hwloc_topology_set_flags(topo, hwloc_flags);
+    }
+    if (qvi_likely(rc == 0)) {
+        rc = hwloc_topology_set_all_types_filter(
+            topo, HWLOC_TYPE_FILTER_KEEP_IMPORTANT
+        );
+    }
+    if (qvi_likely(rc == 0)) {
+        rc = hwloc_topology_set_type_filter(
+            topo, HWLOC_OBJ_OS_DEVICE, HWLOC_TYPE_FILTER_KEEP_IMPORTANT
+        );
+    }
+    if (qvi_likely(rc == 0)) rc = hwloc_topology_load(topo);
+    if (qvi_unlikely(rc != 0)) {
+        hwloc_topology_destroy(topo);
+        return QV_ERR_HWLOC;
+    }
+    *result = topo;
+    return QV_SUCCESS;
+}
+
+int
+qvi_hwloc_io::load(void)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (topo) return QV_SUCCESS;
+
+    const std::string xml_path =
+        topo_snapshot_fname(cache_dir, flags, "io.xml");
+    const std::string key_path =
+        topo_snapshot_fname(cache_dir, flags, "io.key");
+    if (!key.empty() && qvi_read_file(key_path) == key) {
+        if (io_topology_load(xml_path, &topo) == QV_SUCCESS) {
+            return QV_SUCCESS;
+        }
+        qvi_log_warn("Ignoring unusable topology snapshot {}", xml_path);
+    }
+
+    const int rc = io_topology_load("", &topo);
+    if (qvi_unlikely(rc != QV_SUCCESS)) {
+        qvi_log_error("Cannot load I/O topology with rc={}", rc);
+        return rc;
+    }
+    // Failing to save a snapshot only costs us the next warm start.
+    if (!key.empty()) {
+        const int src = topo_save_snapshot(topo, xml_path, key_path, key);
+        if (qvi_unlikely(src != QV_SUCCESS)) {
+            qvi_log_warn("Cannot save topology snapshot in {}", cache_dir);
+        }
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_hwloc::topology_load_cached(
+    qvi_hwloc_flags_t flags,
+    const std::string &cache_dir
+) {
+    const std::string key =
+        cache_dir.empty() ? std::string() : topo_snapshot_key(flags);
+    if (!key.empty()) {
+        const std::string xml_path =
+            topo_snapshot_fname(cache_dir, flags, "xml");
+        const std::string key_path =
+            topo_snapshot_fname(cache_dir, flags, "key");
+        if (qvi_read_file(key_path) == key) {
+            int rc = topology_init(flags);
+            if (qvi_likely(rc == QV_SUCCESS)) {
+                rc = hwloc_topology_set_xml(m_topo, xml_path.c_str());
+                if (qvi_likely(rc == 0)) rc = m_topology_load(true);
+                else rc = QV_ERR_HWLOC;
+            }
+            if (qvi_likely(rc == QV_SUCCESS)) {
+                m_io->cache_dir = cache_dir;
+                m_io->key = key;
+                return rc;
+            }
+            // Start over without the snapshot.
+            qvi_log_warn("Ignoring unusable topology snapshot {}", xml_path);
+            if (m_topo) hwloc_topology_destroy(m_topo);
+            m_topo = nullptr;
+        }
+    }
+
+    int rc = topology_init(flags);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+    rc = topology_load();
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    // The I/O objects we left out share our snapshot cache.
+    m_io->cache_dir = cache_dir;
+    m_io->key = key;
+    // Failing to save a snapshot only costs us the next warm start.
+    if (!key.empty()) {
+        const int src = m_topology_save_snapshot(cache_dir, key);
+        if (qvi_unlikely(src != QV_SUCCESS)) {
+            qvi_log_warn("Cannot save topology snapshot in {}", cache_dir);
+        }
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_hwloc::topology_derive(
+    qvi_hwloc_flags_t flags,
+    const qvi_hwloc &src
+) {
+    m_flags = flags;
+    // The copy keeps the source's topology flags, so it is usable for binding
+    // exactly when the source is.
+    int rc = hwloc_topology_dup(&m_topo, src.m_topo);
+    if (qvi_unlikely(rc != 0)) {
+        qvi_log_error("hwloc_topology_dup() failed");
+        m_topo = nullptr;
+        return QV_ERR_HWLOC;
+    }
+
+    if (m_flags & QVI_HWLOC_FLAG_TOPO_NO_SMT) {
+        rc = m_disable_smt();
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            qvi_log_error("m_disable_smt() failed with rc={}", rc);
+            return rc;
+        }
+    }
+    // Devices are discovered from the same I/O objects as the source's.
+    m_io = src.m_io;
+    return QV_SUCCESS;
+}
+
+int
+qvi_hwloc::topology_allow(
+    const qvi_hwloc_bitmap &cpuset
+) {
+    // PUs that were offline at discovery are not in the topology, so they
+    // cannot be allowed until it is discovered again.
+    qvi_hwloc_bitmap allowed;
+    int rc = hwloc_bitmap_and(
+        allowed.data(), cpuset.cdata(),
+        hwloc_topology_get_topology_cpuset(m_topo)
+    );
+    if (qvi_unlikely(rc != 0)) return QV_ERR_HWLOC;
+    if (qvi_unlikely(hwloc_bitmap_iszero(allowed.cdata()))) {
+        return QV_ERR_HWLOC;
+    }
+    // Leave the allowed memory nodes alone.
+    rc = hwloc_topology_allow(
+        m_topo, allowed.cdata(), nullptr, HWLOC_ALLOW_FLAG_CUSTOM
+    );
+    if (qvi_unlikely(rc != 0)) {
+        qvi_log_error("hwloc_topology_allow() failed");
+        return QV_ERR_HWLOC;
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_hwloc::m_topology_export_dup(
+    hwloc_topology_t *result
+) const {
+    // Either we have our I/O objects, or there are none to be had.
+    hwloc_topology_t src = m_topo;
+    if (!hwloc_get_next_osdev(m_topo, nullptr) && m_io) {
+        const int rc = m_io->load();
+        if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+        src = m_io->topo;
+    }
+
+    hwloc_topology_t topo = nullptr;
+    int rc = hwloc_topology_dup(&topo, src);
+    if (qvi_unlikely(rc != 0)) {
+        qvi_log_error("hwloc_topology_dup() failed");
+        return QV_ERR_HWLOC;
+    }
+    if (src != m_topo) {
+        // Derived topologies (e.g., NO_SMT) cover fewer PUs than the source
+        // of their I/O objects, and the allowed PUs may have changed since.
+        hwloc_const_cpuset_t cpuset =
+            hwloc_topology_get_topology_cpuset(m_topo);
+        hwloc_const_cpuset_t io_cpuset =
+            hwloc_topology_get_topology_cpuset(topo);
+        if (!hwloc_bitmap_isequal(cpuset, io_cpuset)) {
+            rc = hwloc_topology_restrict(topo, cpuset, 0);
+        }
+        if (qvi_likely(rc == 0)) {
+            rc = hwloc_topology_allow(
+                topo, hwloc_topology_get_allowed_cpuset(m_topo), nullptr,
+                HWLOC_ALLOW_FLAG_CUSTOM
+            );
+        }
+        if (qvi_unlikely(rc != 0)) {
+            qvi_log_error("Cannot match the I/O topology to ours");
+            hwloc_topology_destroy(topo);
+            return QV_ERR_HWLOC;
+        }
+    }
+    *result = topo;
+    return QV_SUCCESS;
+}
+
 /**
  *
  */
@@ -497,7 +885,7 @@ qvi_hwloc::s_topo_fopen(
     const std::string &path,
     int *fd
 ) {
-    const int ifd = open(path.c_str(), O_CREAT | O_RDWR, 0644);
+    const int ifd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
     if (qvi_unlikely(ifd == -1)) {
         const int err = errno;
         cstr_t ers = "open() failed";
@@ -521,9 +909,11 @@ int
 qvi_hwloc::topology_export(
     const std::string &base_path
 ) {
-    int qvrc = QV_SUCCESS, rc = 0, fd = 0;
+    int qvrc = QV_SUCCESS, rc = 0, fd = -1;
     cstr_t ers = nullptr;
+    hwloc_topology_t topo = nullptr;
     char *topo_xml = nullptr;
+    std::string tmp_path;
 
     do {
         int err = 0;
@@ -536,9 +926,15 @@ qvi_hwloc::topology_export(
             return QV_ERR;
         }
 
+        qvrc = m_topology_export_dup(&topo);
+        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
+            ers = "m_topology_export_dup() failed";
+            break;
+        }
+
         int topo_xml_len = 0;
         rc = hwloc_topology_export_xmlbuffer(
-            m_topo, &topo_xml, &topo_xml_len,
+            topo, &topo_xml, &topo_xml_len,
             0 // We don't need 1.x compatible XML export.
         );
         if (qvi_unlikely(rc == -1)) {
@@ -547,9 +943,11 @@ qvi_hwloc::topology_export(
             break;
         }
 
-        m_topo_file = topo_fname(base_path, flags());
+        // Clients may be reading a previous export, so replace it whole.
+        const std::string path = topo_fname(base_path, flags());
+        tmp_path = path + ".tmp";
 
-        qvrc = s_topo_fopen(m_topo_file, &fd);
+        qvrc = s_topo_fopen(tmp_path, &fd);
         if (qvi_unlikely(qvrc != QV_SUCCESS)) {
             ers = "topo_fopen() failed";
             break;
@@ -563,16 +961,145 @@ qvi_hwloc::topology_export(
             qvrc = QV_ERR_FILE_IO;
             break;
         }
+
+        rc = rename(tmp_path.c_str(), path.c_str());
+        if (qvi_unlikely(rc == -1)) {
+            const int err = errno;
+            ers = "rename() failed";
+            qvi_log_error("{} {}", ers, strerror(err));
+            qvrc = QV_ERR_FILE_IO;
+            break;
+        }
+        m_topo_file = path;
     } while (false);
 
     if (qvi_unlikely(ers)) {
         qvi_log_error("{} with rc={} ({})", ers, qvrc, qv_strerr(qvrc));
+        if (!tmp_path.empty()) unlink(tmp_path.c_str());
+    }
+    if (topo_xml) hwloc_free_xmlbuffer(topo, topo_xml);
+    if (topo) hwloc_topology_destroy(topo);
+    if (fd != -1) (void)close(fd);
+    return qvrc;
+}
+
+int
+qvi_hwloc::topology_export_shmem(
+    const std::string &base_path,
+    uint64_t addr
+) {
+    int qvrc = QV_SUCCESS, fd = -1;
+    cstr_t ers = nullptr;
+    hwloc_topology_t topo = nullptr;
+    qvi_hwloc_shmem shmem;
+    std::string tmp_path;
+
+    do {
+        qvrc = m_topology_export_dup(&topo);
+        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
+            ers = "m_topology_export_dup() failed";
+            break;
+        }
+
+        size_t length = 0;
+        int rc = hwloc_shmem_topology_get_length(topo, &length, 0);
+        if (qvi_unlikely(rc != 0)) {
+            ers = "hwloc_shmem_topology_get_length() failed";
+            qvrc = QV_ERR_HWLOC;
+            break;
+        }
+        // The mapping must be page-aligned.
+        const size_t pgsize = sysconf(_SC_PAGESIZE);
+        length = ((length + pgsize - 1) / pgsize) * pgsize;
+
+        shmem.path = topo_fname(base_path, flags(), "shmem");
+        shmem.addr = addr;
+        shmem.length = length;
+        // Clients map a previous publication, so it must not be modified.
+        tmp_path = shmem.path + ".tmp";
+
+        qvrc = s_topo_fopen(tmp_path, &fd);
+        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
+            ers = "topo_fopen() failed";
+            break;
+        }
+
+        rc = ftruncate(fd, length);
+        if (qvi_unlikely(rc == -1)) {
+            const int err = errno;
+            ers = "ftruncate() failed";
+            qvi_log_error("{} {}", ers, strerror(err));
+            qvrc = QV_ERR_FILE_IO;
+            break;
+        }
+
+        rc = hwloc_shmem_topology_write(
+            topo, fd, 0, (void *)(uintptr_t)addr, length, 0
+        );
+        if (qvi_unlikely(rc != 0)) {
+            const int err = errno;
+            ers = "hwloc_shmem_topology_write() failed";
+            qvi_log_error("{} {}", ers, strerror(err));
+            qvrc = QV_ERR_HWLOC;
+            break;
+        }
+
+        rc = rename(tmp_path.c_str(), shmem.path.c_str());
+        if (qvi_unlikely(rc == -1)) {
+            const int err = errno;
+            ers = "rename() failed";
+            qvi_log_error("{} {}", ers, strerror(err));
+            qvrc = QV_ERR_FILE_IO;
+            break;
+        }
+        m_topo_shmem = shmem;
+    } while (false);
+
+    if (topo) hwloc_topology_destroy(topo);
+    if (fd != -1) (void)close(fd);
+    if (qvi_unlikely(ers)) {
+        qvi_log_error("{} with rc={} ({})", ers, qvrc, qv_strerr(qvrc));
+        if (!tmp_path.empty()) unlink(tmp_path.c_str());
+        // Don't leave behind a publication of an outdated topology.
+        if (!m_topo_shmem.path.empty()) unlink(m_topo_shmem.path.c_str());
+        m_topo_shmem = qvi_hwloc_shmem();
     }
-    hwloc_free_xmlbuffer(m_topo, topo_xml);
-    (void)close(fd);
     return qvrc;
 }
 
+int
+qvi_hwloc::topology_adopt(
+    qvi_hwloc_flags_t flags,
+    const qvi_hwloc_shmem &shmem
+) {
+    const int fd = open(shmem.path.c_str(), O_RDONLY);
+    if (qvi_unlikely(fd == -1)) return QV_ERR_FILE_IO;
+    // The mapping outlives the descriptor.
+    const int rc = hwloc_shmem_topology_adopt(
+        &m_topo, fd, 0, (void *)(uintptr_t)shmem.addr, shmem.length, 0
+    );
+    const int err = errno;
+    (void)close(fd);
+    // Likely because the address range is already in use in this process.
+    // This isn't fatal: callers can fall back to loading the topology.
+    if (rc != 0) {
+        qvi_log_debug(
+            "hwloc_shmem_topology_adopt({}) failed: {}",
+            shmem.path, strerror(err)
+        );
+        m_topo = nullptr;
+        return QV_ERR_HWLOC;
+    }
+    m_flags = flags | QVI_HWLOC_FLAG_TOPO_SHMEM;
+    return QV_SUCCESS;
+}
+
+const qvi_hwloc_shmem &
+qvi_hwloc::topology_shmem(void) const
+{
+    return m_topo_shmem;
+}
+
 hwloc_topology_t
 qvi_hwloc::topology_get(void)
 {
@@ -698,10 +1225,11 @@ qvi_hwloc::bind_string(
 
 int
 qvi_hwloc::m_set_device_info(
+    hwloc_topology_t io_topo,
     hwloc_obj_t obj,
     const std::string &pci_bus_id,
     qvi_hwloc_device *device
-) {
+) const {
     std::string uuid_info_name = {};
     switch (obj->attr->osdev.type) {
         case HWLOC_OBJ_OSDEV_GPU: {
@@ -743,7 +1271,7 @@ qvi_hwloc::m_set_device_info(
     device->uuid = get_obj_info_by_name(obj, uuid_info_name);
     // Set the affinity.
     return m_set_device_affinity_by_pci_bus_id(
-        pci_bus_id, device
+        io_topo, pci_bus_id, device
     );
 }
 
@@ -760,13 +1288,14 @@ qvi_hwloc::m_set_device_info(
  */
 int
 qvi_hwloc::m_set_device_affinity_by_pci_bus_id(
+    hwloc_topology_t io_topo,
     const std::string &busid,
     qvi_hwloc_device *dev
-) {
+) const {
     int rc = QV_SUCCESS;
     do {
         hwloc_obj_t pci_dev = hwloc_get_pcidev_by_busidstring(
-            m_topo, busid.c_str()
+            io_topo, busid.c_str()
         );
         if (qvi_unlikely(!pci_dev)) {
             rc = QV_ERR_NOT_FOUND;
@@ -774,15 +1303,20 @@ qvi_hwloc::m_set_device_affinity_by_pci_bus_id(
         }
         // Jump to the closest non-I/O ancestor. This is the
         // CPU/Memory node the PCI bus is physically wired to.
-        hwloc_obj_t ancestor = hwloc_get_non_io_ancestor_obj(m_topo, pci_dev);
+        hwloc_obj_t ancestor = hwloc_get_non_io_ancestor_obj(io_topo, pci_dev);
         // Walk up the parents until we find the package (i.e., CPU socket).
         hwloc_obj_t package = ancestor;
         while (package && package->type != HWLOC_OBJ_PACKAGE) {
             package = package->parent;
         }
-        // Found it!
+        // Found it! The I/O topology may not be restricted like ours is
+        // (e.g., to disable SMT), so only keep the CPUs that we have.
         if (package) {
             dev->affinity.set(package->cpuset);
+            hwloc_bitmap_and(
+                dev->affinity.data(), dev->affinity.cdata(),
+                hwloc_topology_get_topology_cpuset(m_topo)
+            );
         }
         else {
             rc = QV_ERR_NOT_FOUND;
@@ -791,20 +1325,31 @@ qvi_hwloc::m_set_device_affinity_by_pci_bus_id(
     } while (false);
     if (qvi_unlikely(rc != QV_SUCCESS)) {
         // Do our best here: just set it to the allowed resources.
-        return dev->affinity.set(topology_get_cpuset());
+        return dev->affinity.set(hwloc_topology_get_allowed_cpuset(m_topo));
     }
     return QV_SUCCESS;
 }
 
 int
-qvi_hwloc::m_discover_devices(void)
+qvi_hwloc::m_discover_devices(void) const
 {
+    std::lock_guard<std::mutex> guard(m_devmap_mutex);
+    if (m_devmap_ready) return QV_SUCCESS;
+    // Topologies loaded from files include their I/O objects, if any.
+    // Otherwise, get them from the I/O topology we left them out of.
+    hwloc_topology_t io_topo = m_topo;
+    if (!hwloc_get_next_osdev(m_topo, nullptr) && m_io) {
+        const int rc = m_io->load();
+        if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+        io_topo = m_io->topo;
+    }
+
     int rc = QV_SUCCESS;
     // This will maintain a mapping of PCI bus IDs to devices.
     qvi_hwloc_pci2dev devmap;
 
     hwloc_obj_t obj = nullptr;
-    while ((obj = hwloc_get_next_osdev(m_topo, obj)) != nullptr) {
+    while ((obj = hwloc_get_next_osdev(io_topo, obj)) != nullptr) {
         // Skip this object?
         if (!keep_os_device(obj)) continue;
         // Try to get the PCI object.
@@ -825,7 +1370,7 @@ qvi_hwloc::m_discover_devices(void)
         }
         // Set the information on the device. This could be the first time that
         // the device has been seen, or the nth time.
-        rc = m_set_device_info(obj, busid, dev.get());
+        rc = m_set_device_info(io_topo, obj, busid, dev.get());
         if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
     }
     // Now that we have all the device information that we are going to get,
@@ -846,6 +1391,7 @@ qvi_hwloc::m_discover_devices(void)
             }
         );
     }
+    m_devmap_ready = true;
     return QV_SUCCESS;
 }
 
@@ -998,10 +1544,13 @@ qvi_hwloc::get_nobjs_in_cpuset(
 ) const {
     switch (target_obj) {
         case(QV_HW_OBJ_GPU) :
-        case(QV_HW_OBJ_NIC) :
+        case(QV_HW_OBJ_NIC) : {
+            const int rc = m_discover_devices();
+            if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
             return m_get_nosdevs_in_cpuset(
                 cget_dev_list(m_devmap, target_obj), cpuset, nobjs
             );
+        }
         default:
             return m_get_nobjs_in_cpuset(target_obj, cpuset, nobjs);
     }
@@ -1034,6 +1583,9 @@ int
 qvi_hwloc::devices_emit(
     qv_hw_obj_type_t obj_type
 ) const {
+    const int rc = m_discover_devices();
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
     for (auto &dev : cget_dev_list(m_devmap, obj_type)) {
         const std::string cpusets = qvi_hwloc::bitmap_list_string(
             dev->affinity.cdata()
@@ -1068,6 +1620,9 @@ qvi_hwloc::get_devices_included_in_cpuset(
     hwloc_const_cpuset_t cpuset,
     qvi_hwloc_dev_list &devs
 ) const {
+    const int rc = m_discover_devices();
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
     return get_devices_in_cpuset_from_dev_list(
         cget_dev_list(m_devmap, obj_type), cpuset, devs
     );
@@ -1140,7 +1695,7 @@ qvi_hwloc::get_cpuset_for_nobjs(
     qv_hw_obj_type_t obj_type,
     uint_t nobjs,
     qvi_hwloc_bitmap &result
-) {
+) const {
     // Zero-out the result bitmap that will encode the result.
     hwloc_bitmap_zero(result.data());
     // Get the target object's depth.
@@ -22,6 +22,7 @@
 // Forward declarations.
 struct qvi_hwloc_bitmap;
 struct qvi_hwloc_device;
+struct qvi_hwloc_io;
 
 /** Set of device identifiers. */
 using qvi_hwloc_dev_id_set = std::unordered_set<std::string>;
@@ -45,9 +46,34 @@ const qvi_hwloc_flags_t QVI_HWLOC_FLAG_TOPO_FULL = (1LL<<0);
 const qvi_hwloc_flags_t QVI_HWLOC_FLAG_TOPO_NO_SMT = (1LL<<1);
 /** Indicates that the topology was loaded from exported XML file. */
 const qvi_hwloc_flags_t QVI_HWLOC_FLAG_TOPO_XML = (1LL<<2);
+/** Indicates that the topology was adopted from shared memory (read-only). */
+const qvi_hwloc_flags_t QVI_HWLOC_FLAG_TOPO_SHMEM = (1LL<<3);
 
 const qvi_hwloc_flags_t QVI_HWLOC_TOPO_MASK = 0x0000000000000003LL;
 
+/**
+ * Describes a topology published in a file-backed shared-memory mapping. The
+ * topology must be adopted at the exact same address and length it was
+ * published at, so a publication is only usable by processes where that
+ * virtual address range is free.
+ */
+struct qvi_hwloc_shmem {
+    /** Path to the backing file. Empty if nothing was published. */
+    std::string path = {};
+    /** Virtual address at which the topology must be mapped. */
+    uint64_t addr = 0;
+    /** Length of the mapping in bytes. */
+    uint64_t length = 0;
+    /** Serializes a qvi_hwloc_shmem. */
+    template <class Archive>
+    void
+    serialize(
+        Archive &archive
+    ) {
+        archive(path, addr, length);
+    }
+};
+
 /** Internal resource type identifiers. */
 enum qvi_hwloc_res_class {
     QVI_HWLOC_RES_CLASS_HOST = 0,
@@ -67,13 +93,42 @@ private:
     hwloc_topology_t m_topo = nullptr;
     /** Path to exported hardware topology. */
     std::string m_topo_file;
+    /** Describes the topology's shared-memory publication, if any. */
+    qvi_hwloc_shmem m_topo_shmem;
+    /**
+     * Source of the I/O objects missing from the topology, loaded on first
+     * use. Shared with the topologies derived from this one. Topologies loaded
+     * from files already include theirs, so they have none.
+     */
+    std::shared_ptr<qvi_hwloc_io> m_io;
+    /** Protects device discovery, which happens on first use. */
+    mutable std::mutex m_devmap_mutex;
+    /** Whether devices have been discovered. */
+    mutable bool m_devmap_ready = false;
     /** Map of device types to lists of devices of those types. */
-    qvi_hwloc_dev_map m_devmap;
+    mutable qvi_hwloc_dev_map m_devmap;
     /** */
     int
     m_topo_set_from_xml(
         const std::string &path
     );
+    /**
+     * Loads the initialized topology. A snapshot describes this system and
+     * already reflects our flags.
+     */
+    int
+    m_topology_load(
+        bool from_snapshot
+    );
+    /**
+     * Saves a snapshot of the loaded topology in the provided cache directory
+     * under the provided key.
+     */
+    int
+    m_topology_save_snapshot(
+        const std::string &cache_dir,
+        const std::string &key
+    );
     /** */
     static int
     s_topo_fopen(
@@ -85,19 +140,33 @@ private:
      */
     int
     m_set_device_affinity_by_pci_bus_id(
+        hwloc_topology_t io_topo,
         const std::string &busid,
         qvi_hwloc_device *dev
-    );
-    /** */
+    ) const;
+    /**
+     * Discovers the devices of interest, if not already done. I/O discovery
+     * is costly, so this only happens once devices are first needed.
+     */
+    int
+    m_discover_devices(void) const;
+    /**
+     * Returns a copy of the loaded topology to export, which the caller must
+     * destroy. Unlike ours, it includes I/O objects, so that consumers find
+     * devices without discovering them again.
+     */
     int
-    m_discover_devices(void);
+    m_topology_export_dup(
+        hwloc_topology_t *result
+    ) const;
     /** */
     int
     m_set_device_info(
+        hwloc_topology_t io_topo,
         hwloc_obj_t obj,
         const std::string &pci_bus_id,
         qvi_hwloc_device *device
-    );
+    ) const;
     /** */
     int
     m_task_obj_xop_by_type_id(
@@ -164,6 +233,16 @@ public:
         };
         return topo_type_flags;
     }
+    /**
+     * Returns the paths under the provided root of the files listing the
+     * effective CPUs, or memory nodes, of the cgroup cpuset we run in: that of
+     * cgroup v2, then that of v1.
+     */
+    static std::vector<std::string>
+    cgroup_cpuset_files(
+        const std::string &root,
+        bool mems = false
+    );
     /** */
     static int
     bitmap_calloc(
@@ -250,17 +329,73 @@ public:
         const std::string &xml_path = ""
     );
     /**
-     *
+     * Loads the initialized topology. When loading from this system, I/O
+     * objects are left out: devices are discovered when first needed.
      */
     int
     topology_load(void);
     /**
-     *
+     * Loads the topology from its snapshot in the provided cache directory if
+     * the snapshot is still valid for this system: same boot, kernel, online
+     * CPUs, and cgroup cpuset. Otherwise, loads the topology from this system
+     * and saves a new snapshot. Used in place of topology_init() and
+     * topology_load().
+     */
+    int
+    topology_load_cached(
+        qvi_hwloc_flags_t flags,
+        const std::string &cache_dir
+    );
+    /**
+     * Derives a topology of the provided type from the provided loaded one
+     * (e.g., a QVI_HWLOC_FLAG_TOPO_NO_SMT view of a full topology) without
+     * discovering the hardware again. Used in place of topology_init() and
+     * topology_load().
+     */
+    int
+    topology_derive(
+        qvi_hwloc_flags_t flags,
+        const qvi_hwloc &src
+    );
+    /**
+     * Sets the PUs allowed in the loaded topology, which must include
+     * disallowed resources, without discovering the hardware again. PUs
+     * outside the topology are ignored.
+     */
+    int
+    topology_allow(
+        const qvi_hwloc_bitmap &cpuset
+    );
+    /**
+     * Exports the loaded topology to an XML file under the provided base path.
+     * A previous export is replaced atomically, so readers never see a
+     * partial file.
      */
     int
     topology_export(
         const std::string &base_path
     );
+    /**
+     * Publishes the loaded topology in a shared-memory file under the provided
+     * base path. Consumers must map it at the provided page-aligned address.
+     * A previous publication is replaced without modifying the file consumers
+     * may have mapped, or withdrawn on failure.
+     */
+    int
+    topology_export_shmem(
+        const std::string &base_path,
+        uint64_t addr
+    );
+    /**
+     * Adopts, read-only, a topology previously published in shared memory.
+     * Used in place of topology_init() and topology_load(). On failure, the
+     * instance is left uninitialized so that those may be used instead.
+     */
+    int
+    topology_adopt(
+        qvi_hwloc_flags_t flags,
+        const qvi_hwloc_shmem &shmem
+    );
     /**
      *
      */
@@ -271,6 +406,11 @@ public:
      */
     std::string
     topology_file(void);
+    /**
+     * Returns information about the topology's shared-memory publication.
+     */
+    const qvi_hwloc_shmem &
+    topology_shmem(void) const;
     /**
      *
      */
@@ -411,7 +551,7 @@ public:
         qv_hw_obj_type_t obj_type,
         uint_t nobjs,
         qvi_hwloc_bitmap &result
-    );
+    ) const;
 };
 
 /**
@@ -465,6 +605,8 @@ public:
 struct qvi_hwloc_bitmap {
     friend class cereal::access;
 private:
+    /** Number of bits in an unsigned long, the unit of our wire encoding. */
+    static constexpr int s_ulong_bits = sizeof(unsigned long) * CHAR_BIT;
     /** Internal bitmap. */
     hwloc_bitmap_t m_data = nullptr;
 public:
@@ -561,15 +703,30 @@ public:
         return result;
     }
     /**
-     * Serializes a qvi_hwloc_bitmap.
+     * Serializes a qvi_hwloc_bitmap. The wire format is a flag indicating
+     * whether the bitmap is infinitely set beyond its explicitly encoded
+     * words, followed by those words (least significant first).
      */
     template<class Archive>
     void
     save(
         Archive &archive
     ) const {
-        // We are sending the string representation of the cpuset.
-        archive(qvi_hwloc::bitmap_string(qvi_hwloc_bitmap(m_data)));
+        bool infinite = false;
+        int nwords = hwloc_bitmap_nr_ulongs(m_data);
+        // Infinite bitmaps only need words up to (and including) the last
+        // unset bit. Everything after that is implied by the flag.
+        if (nwords == -1) {
+            infinite = true;
+            const int last_unset = hwloc_bitmap_last_unset(m_data);
+            nwords = (last_unset == -1) ? 0 : last_unset / s_ulong_bits + 1;
+        }
+        std::vector<unsigned long> words(nwords);
+        if (nwords > 0) {
+            const int rc = hwloc_bitmap_to_ulongs(m_data, nwords, words.data());
+            if (qvi_unlikely(rc != 0)) throw qvi_runtime_error(QV_ERR_HWLOC);
+        }
+        archive(infinite, words);
     }
     /**
      * Deserializes a qvi_hwloc_bitmap.
@@ -579,12 +736,17 @@ public:
     load(
         Archive &archive
     ) {
-        std::string bitmaps;
-        archive(bitmaps);
-        const int rc = qvi_hwloc::bitmap_sscanf(
-            m_data, const_cast<char *>(bitmaps.c_str())
-        );
-        if (qvi_unlikely(rc != QV_SUCCESS)) throw qvi_runtime_error(rc);
+        bool infinite = false;
+        std::vector<unsigned long> words;
+        archive(infinite, words);
+
+        const int nwords = int(words.size());
+        int rc = hwloc_bitmap_from_ulongs(m_data, nwords, words.data());
+        if (qvi_unlikely(rc != 0)) throw qvi_runtime_error(QV_ERR_HWLOC);
+        if (infinite) {
+            rc = hwloc_bitmap_set_range(m_data, nwords * s_ulong_bits, -1);
+            if (qvi_unlikely(rc != 0)) throw qvi_runtime_error(QV_ERR_HWLOC);
+        }
     }
 };
 
@@ -18,13 +18,13 @@
 #include "qvi-scope.h"
 
 // TODOs
-// * Resource reference counting.
-// * Need to deal with resource unavailability.
+// * Need to deal with resource unavailability in splits. Exclusive
+//   reservations are only honored by qv_scope::create() for now, see
+//   qvi_rmi_client::reserve().
 // * Split and attach devices properly.
 // * Have bitmap scratch pad that is initialized once, then destroyed? This
 //   approach may be a nice allocation optimization, but in heavily threaded
 //   code may be a bottleneck.
-// * Add RMI to acquire/release resources.
 
 // Notes:
 // * Does it make sense attempting resource exclusivity? Why not just let the
@@ -137,7 +137,7 @@ qvi_hwsplit::m_split_cpuset(void)
     //const size_t real_split_size = m_split_size;
     //qvi_log_debug("Real Split Size: {}", real_split_size);
     // Split the primary cpuset into the requested split size pieces.
-    return m_my_rmi.hwloc().bitmap_split(
+    return m_my_rmi.hwloc()->bitmap_split(
         pri_cpuset, real_split_size, m_split_cpusets
     );
 }
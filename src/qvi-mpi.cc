@@ -134,7 +134,7 @@ qvi_mpi_group::scatter_bbuffs(
     int mpirc = MPI_SUCCESS, rxcount = 0;
     int total_bytes = 0;
     std::vector<int> txcounts, displs;
-    std::vector<byte_t> mybytes, txbytes;
+    std::vector<byte_t> txbytes;
     // Root sets up relevant Scatterv data structures.
     if (group_id == root) {
         txcounts.resize(group_size);
@@ -161,16 +161,17 @@ qvi_mpi_group::scatter_bbuffs(
         root, qvcomm.m_mpi_comm
     );
     if (qvi_unlikely(mpirc != MPI_SUCCESS)) return QV_ERR_MPI;
-    // Everyone allocates a buffer for their data.
-    mybytes.resize(rxcount);
+    // Everyone sizes their buffer to receive their data directly into it.
+    const int rc = rxbuff.resize(rxcount);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
 
     mpirc = MPI_Scatterv(
         txbytes.data(), txcounts.data(), displs.data(), MPI_UINT8_T,
-        mybytes.data(), rxcount, MPI_UINT8_T, root, qvcomm.m_mpi_comm
+        rxbuff.data(), rxcount, MPI_UINT8_T, root, qvcomm.m_mpi_comm
     );
     if (qvi_unlikely(mpirc != MPI_SUCCESS)) return QV_ERR_MPI;
 
-    return rxbuff.append(mybytes.data(), rxcount);
+    return QV_SUCCESS;
 }
 
 int
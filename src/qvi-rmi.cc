@@ -28,11 +28,31 @@ format_as(
     return fmt::underlying(e);
 }
 
-// Indicates whether the server has been signaled to shutdown.
-static volatile std::sig_atomic_t g_server_shutdown_signaled(false);
+// In-process endpoint connecting the front end to the server's workers.
+static constexpr cstr_t s_workers_url = "inproc://qvi-rmi-workers";
+
+// In-process endpoint workers use to notify the main loop of their exit.
+static constexpr cstr_t s_control_url = "inproc://qvi-rmi-control";
+
+// Base virtual address of topologies published in shared memory.
+static constexpr uint64_t s_shmem_base_addr = 0x200000000000ULL;
 
 struct qvi_rmi_msg_header {
     qvi_rmi_rpc_fid_t fid = QVI_RMI_FID_INVALID;
+    /** Request ID, echoed by the server so replies can be matched. */
+    uint64_t rid = 0;
+    /** When the server received the request. Set by the server. */
+    uint64_t rx_ns = 0;
+    /**
+     * Generation of the server's view of the hardware when it replied. Set
+     * by the server.
+     */
+    uint64_t gen = 0;
+    /**
+     * Process that sent the request, as determined from its connection. 0 if
+     * the transport cannot tell. Set by the server.
+     */
+    pid_t peer = 0;
 };
 
 /**
@@ -53,11 +73,69 @@ do {                                                                          \
     qvi_log_warn("{} with errno={} ({})", ers, erno, strerror(erno));         \
 } while (0)
 
+/**
+ * Returns the signals handled by the server's main loop: SIGUSR1 requests a
+ * statistics dump, and the others request a shutdown.
+ */
+static sigset_t
+server_signals(void)
+{
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGTERM);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGHUP);
+    sigaddset(&sigs, SIGUSR1);
+    return sigs;
+}
+
+/**
+ * Returns the directory holding the server's topology snapshots, creating it
+ * if needed. Returns an empty string if it cannot be used safely: snapshots
+ * are trusted, so the directory must be ours and private.
+ */
+static std::string
+topo_cache_dir(void)
+{
+    const std::string path = qvi_cache_dir();
+    if (qvi_unlikely(!qvi_private_dir(path, true))) {
+        qvi_log_warn("Not using topology snapshots in {}", path);
+        return std::string();
+    }
+    return path;
+}
+
+/**
+ * Notifies the provided readiness descriptor, if any, and closes it.
+ */
 static void
-server_signal_handler(
-    int
+notify_ready(
+    int &ready_fd
 ) {
-    g_server_shutdown_signaled = true;
+    if (ready_fd == -1) return;
+
+    static constexpr char ready = 1;
+    ssize_t nwritten = 0;
+    do {
+        nwritten = write(ready_fd, &ready, sizeof(ready));
+    } while (nwritten == -1 && errno == EINTR);
+    if (qvi_unlikely(nwritten != sizeof(ready))) {
+        qvi_log_warn("Cannot notify readiness on fd {}", ready_fd);
+    }
+    (void)close(ready_fd);
+    ready_fd = -1;
+}
+
+/**
+ * Returns the current time of a monotonic clock in nanoseconds.
+ */
+static inline uint64_t
+steady_ns(void)
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
 }
 
 static inline void
@@ -139,6 +217,47 @@ zsocket_create_and_bind(
     return zsock;
 }
 
+/**
+ * Returns whether a server is accepting connections at the provided URL. Only
+ * meaningful for ipc:// endpoints: binding to a path that is already in use
+ * silently replaces the existing endpoint instead of failing like TCP does.
+ */
+static bool
+zendpoint_in_use(
+    const std::string &url
+) {
+    static const std::string ipc_scheme = "ipc://";
+    if (!url.starts_with(ipc_scheme)) return false;
+
+    const std::string path = url.substr(ipc_scheme.size());
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (qvi_unlikely(fd == -1)) return false;
+    const int rc = ::connect(fd, (sockaddr *)&addr, sizeof(addr));
+    close(fd);
+    return rc == 0;
+}
+
+static inline int
+zsocket_set_linger(
+    void *zsock,
+    int linger
+) {
+    const int zrc = zmq_setsockopt(
+        zsock, ZMQ_LINGER, &linger, sizeof(linger)
+    );
+    if (qvi_unlikely(zrc != 0)) {
+        const int eno = errno;
+        zerr_msg("zmq_setsockopt(ZMQ_LINGER) failed", eno);
+        return QV_ERR_SYS;
+    }
+    return QV_SUCCESS;
+}
+
 static inline int
 buffer_append_header(
     qvi_bbuff *buff,
@@ -149,6 +268,26 @@ buffer_append_header(
     return buff->append(&hdr, sizeof(hdr));
 }
 
+static inline void
+buffer_set_rid(
+    qvi_bbuff *buff,
+    uint64_t rid
+) {
+    byte_t *data = (byte_t *)buff->data();
+    data += offsetof(qvi_rmi_msg_header, rid);
+    memcpy(data, &rid, sizeof(rid));
+}
+
+static inline void
+buffer_set_gen(
+    qvi_bbuff *buff,
+    uint64_t gen
+) {
+    byte_t *data = (byte_t *)buff->data();
+    data += offsetof(qvi_rmi_msg_header, gen);
+    memcpy(data, &gen, sizeof(gen));
+}
+
 static inline void *
 data_trim(
     void *msg,
@@ -169,6 +308,18 @@ unpack_msg_header(
     return hdrsize;
 }
 
+/**
+ * Frees a byte buffer once ZMQ is done with the message it backs.
+ */
+static void
+zmsg_free_bbuff(
+    void *,
+    void *hint
+) {
+    qvi_bbuff *bbuff = static_cast<qvi_bbuff *>(hint);
+    qvi_delete(&bbuff);
+}
+
 static inline int
 zsock_send_bbuff(
     void *zsock,
@@ -176,78 +327,66 @@ zsock_send_bbuff(
     int *bsent
 ) {
     const int buff_size = bbuff->size();
-    *bsent = zmq_send(zsock, bbuff->data(), buff_size, 0);
+    // Hand the buffer's storage to ZMQ without copying it. From here on,
+    // ZMQ owns the buffer and frees it through zmsg_free_bbuff().
+    zmq_msg_t msg;
+    int zrc = zmq_msg_init_data(
+        &msg, bbuff->data(), buff_size, zmsg_free_bbuff, bbuff
+    );
+    if (qvi_unlikely(zrc != 0)) {
+        const int eno = errno;
+        zerr_msg("zmq_msg_init_data() failed", eno);
+        qvi_delete(&bbuff);
+        return QV_ERR_RPC;
+    }
+    *bsent = zmq_msg_send(&msg, zsock, 0);
     if (qvi_unlikely(*bsent != buff_size)) {
         const int eno = errno;
-        zerr_msg("zmq_send() truncated", eno);
+        zerr_msg("zmq_msg_send() truncated", eno);
+        zmq_msg_close(&msg);
         return QV_ERR_RPC;
     }
-    // We are responsible for freeing the buffer after ZMQ has
-    // taken ownership of its contents after zmq_send() returns.
-    qvi_delete(&bbuff);
     return QV_SUCCESS;
 }
 
-int
-qvi_rmi_server::m_recv_msg(
-    zmq_msg_t *mrx
+/**
+ * Returns the size of the data packed by qvi_bbuff::pack() starting at data.
+ */
+static inline size_t
+packed_size(
+    const void *data
 ) {
-    int qvrc = QV_SUCCESS;
-
-    int zrc = zmq_msg_init(mrx);
-    if (qvi_unlikely(zrc != 0)) {
-        const int eno = errno;
-        zerr_msg("zmq_msg_init() failed", eno);
-        return QV_ERR_RPC;
-    }
+    size_t len = 0;
+    memcpy(&len, data, sizeof(len));
+    return sizeof(len) + len;
+}
 
-    const int npoll_items = 1;
-    zmq_pollitem_t poll_items[npoll_items] = {
-        // Monitor m_zsock for incoming messages (recv).
-        {m_zsock, 0, ZMQ_POLLIN, 0}
-    };
+/**
+ * Returns the size of the message (header and packed body) starting at data.
+ */
+static inline size_t
+rpc_msg_size(
+    const void *data
+) {
+    const size_t hdrsize = sizeof(qvi_rmi_msg_header);
+    return hdrsize + packed_size((const byte_t *)data + hdrsize);
+}
 
-    do {
-        if (qvi_unlikely(g_server_shutdown_signaled)) {
-            qvrc = QV_SUCCESS_SHUTDOWN;
-            break;
-        }
-        // Poll for events with a timeout of 1000ms.
-        zrc = zmq_poll(poll_items, npoll_items, 1000);
-        if (qvi_unlikely(zrc == -1)) {
-            const int eno = errno;
-            // Poll interrupted by delivery of a signal before any events were
-            // available. Continue to see if we had any new relevant signal
-            // events.
-            if (eno == EINTR) {
-                continue;
-            }
-            // A real error occurred.
-            else {
-                zerr_msg("zmq_poll() failed", eno);
-                qvrc = QV_ERR_RPC;
-                break;
-            }
-        }
-        // Timeout, no events.
-        else if (zrc == 0) {
-            continue;
-        }
-        // Events on the socket ready for receipt.
-        if (poll_items[0].revents & ZMQ_POLLIN) {
-            // Perform a blocking receive of the available message.
-            zrc = zmq_msg_recv(mrx, m_zsock, 0);
-            if (qvi_unlikely(zrc == -1)) {
-                const int eno = errno;
-                zerr_msg("zmq_msg_recv() failed", eno);
-                qvrc = QV_ERR_RPC;
-            }
-            break;
-        }
-    } while (true);
+/**
+ * Appends a message (header and packed body) to the provided buffer.
+ */
+template <typename... Types>
+static inline int
+rpc_pack_into(
+    qvi_bbuff *buff,
+    qvi_rmi_rpc_fid_t fid,
+    Types &&...args
+) {
+    // Fill and add header.
+    const int rc = buffer_append_header(buff, fid);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
 
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) zmq_msg_close(mrx);
-    return qvrc;
+    return buff->pack(std::forward<Types>(args)...);
 }
 
 template <typename... Types>
@@ -262,11 +401,8 @@ rpc_pack(
     do {
         rc = qvi_new(&ibuff);
         if (qvi_unlikely(rc != QV_SUCCESS)) break;
-        // Fill and add header.
-        rc = buffer_append_header(ibuff, fid);
-        if (qvi_unlikely(rc != QV_SUCCESS)) break;
 
-        rc = ibuff->pack(std::forward<Types>(args)...);
+        rc = rpc_pack_into(ibuff, fid, std::forward<Types>(args)...);
     } while (false);
 
     if (qvi_unlikely(rc != QV_SUCCESS)) {
@@ -290,143 +426,721 @@ rpc_unpack(
     );
 }
 
-qvi_rmi_client::~qvi_rmi_client(void)
+/**
+ * Unpacks a reply whose body starts with the RPC return code. Returns the
+ * unpack status when unpacking fails, otherwise the RPC return code.
+ */
+template <typename... Types>
+static inline int
+rpc_unpack_rep(
+    void *data,
+    Types &&...args
+) {
+    // Should be set by rpc_unpack, so assume an error.
+    int rpcrc = QV_ERR_RPC;
+    const int rc = rpc_unpack(data, rpcrc, std::forward<Types>(args)...);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return rpcrc;
+}
+
+size_t
+qvi_rmi_rpc_stats::bucket(
+    uint64_t ns
+) {
+    const uint64_t us = ns / 1000;
+    // std::bit_width(us) is the bucket whose range contains us.
+    return std::min(size_t(std::bit_width(us)), nbuckets - 1);
+}
+
+void
+qvi_rmi_rpc_counters::record(
+    size_t req_bytes,
+    size_t rep_bytes,
+    uint64_t wait_ns,
+    uint64_t service_ns
+) {
+    // Counters are independent, so relaxed ordering suffices.
+    constexpr auto order = std::memory_order_relaxed;
+    count.fetch_add(1, order);
+    bytes_in.fetch_add(req_bytes, order);
+    bytes_out.fetch_add(rep_bytes, order);
+    queue_ns.fetch_add(wait_ns, order);
+    handler_ns.fetch_add(service_ns, order);
+    queue_hist[qvi_rmi_rpc_stats::bucket(wait_ns)].fetch_add(1, order);
+    handler_hist[qvi_rmi_rpc_stats::bucket(service_ns)].fetch_add(1, order);
+}
+
+qvi_rmi_rpc_stats
+qvi_rmi_rpc_counters::snapshot(void) const
 {
-    // Make sure we can safely call zmq_ctx_destroy(). Otherwise it will hang.
-    if (m_connected) {
-        zsocket_close(m_zsock);
-        zctx_destroy(&m_zctx);
+    constexpr auto order = std::memory_order_relaxed;
+    qvi_rmi_rpc_stats result;
+    result.count = count.load(order);
+    result.bytes_in = bytes_in.load(order);
+    result.bytes_out = bytes_out.load(order);
+    result.queue_ns = queue_ns.load(order);
+    result.handler_ns = handler_ns.load(order);
+    for (size_t i = 0; i < qvi_rmi_rpc_stats::nbuckets; ++i) {
+        result.queue_hist[i] = queue_hist[i].load(order);
+        result.handler_hist[i] = handler_hist[i].load(order);
     }
+    return result;
 }
 
-qvi_hwloc &
-qvi_rmi_client::hwloc(void)
-{
-    return m_hwloc;
+/**
+ * Whether the provided types match those of the provided tuple, ignoring
+ * references and cv-qualifiers.
+ */
+template <typename Tuple, typename... Types>
+static constexpr bool rpc_types_match = std::is_same_v<
+    Tuple, std::tuple<std::remove_cvref_t<Types>...>
+>;
+
+/**
+ * Packs a request for the RPC identified by FID into the provided buffer.
+ * The arguments are checked against the RPC's schema at compile time.
+ */
+template <qvi_rmi_rpc_fid_t FID, typename... Types>
+static inline int
+rpc_pack_req_into(
+    qvi_bbuff *buff,
+    Types &&...args
+) {
+    static_assert(
+        rpc_types_match<typename qvi_rmi_rpc_schema<FID>::args, Types...>,
+        "RPC arguments do not match the RPC's schema"
+    );
+    return rpc_pack_into(buff, FID, std::forward<Types>(args)...);
 }
 
-int
-qvi_rmi_client::discover(
-    int &portno
+/**
+ * Returns an unpacker of replies to the RPC identified by FID that writes the
+ * results to the provided output arguments. The output arguments are checked
+ * against the RPC's schema at compile time.
+ */
+template <qvi_rmi_rpc_fid_t FID, typename... Types>
+static inline qvi_rmi_unpack_fun_t
+rpc_rep_unpacker(
+    std::tuple<Types &...> results
 ) {
-    int rc = QV_SUCCESS;
-    // If this fails, envport is set to QVI_COMM_PORT_UNSET.
-    int envport = qvi_port_from_env();
-    // A connection port is requested via environment variable.
-    if (envport != QVI_PORT_UNSET) {
-        rc = qvi_session_discover(1024, envport);
-        // Found it!
-        if (rc == QV_SUCCESS) {
-            portno = envport;
-            return rc;
-        }
-    }
-    // Try to discover an arbitrary, active session.
-    return qvi_session_discover(1024, portno);
+    static_assert(
+        rpc_types_match<typename qvi_rmi_rpc_schema<FID>::results, Types...>,
+        "RPC results do not match the RPC's schema"
+    );
+    return [results](void *data) {
+        return std::apply(
+            [data](auto &...rs) { return rpc_unpack_rep(data, rs...); },
+            results
+        );
+    };
+}
+
+qvi_rmi_batch::qvi_rmi_batch(
+    qvi_rmi_client &rmi
+) : m_rmi(rmi)
+  , m_flags(rmi.m_hwloc_flags) { }
+
+size_t
+qvi_rmi_batch::size(void) const
+{
+    return m_unpackers.size();
 }
 
+template <qvi_rmi_rpc_fid_t FID, typename... Results, typename... Types>
 int
-qvi_rmi_client::connect(
-    qv_scope_flags_t scope_flags,
-    const std::string &url,
-    const int portno
+qvi_rmi_batch::m_add(
+    std::tuple<Results &...> results,
+    Types &&...args
 ) {
-    // Create a new ZMQ context.
-    m_zctx = zmq_ctx_new();
-    if (qvi_unlikely(!m_zctx)) return QV_RES_UNAVAILABLE;
-    // Create the ZMQ socket used for communication with the server.
-    m_zsock = zsocket_create(m_zctx, ZMQ_REQ);
-    if (qvi_unlikely(!m_zsock)) return QV_RES_UNAVAILABLE;
-    // Note: ZMQ_CONNECT_TIMEOUT doesn't seem to have an appreciable effect.
-    int zrc = zsocket_connect(m_zsock, url.c_str());
-    if (qvi_unlikely(zrc != 0)) {
-        const int eno = errno;
-        zerr_msg("zsocket_connect() failed", eno);
-        return QV_RES_UNAVAILABLE;
-    }
-    // To avoid hangs in faulty connections, set a timeout
-    // before initiating the first client/server exchange.
-    const int timeout_in_ms = 5000;
-    zrc = zmq_setsockopt(
-        m_zsock, ZMQ_RCVTIMEO, &timeout_in_ms, sizeof(timeout_in_ms)
+    const size_t prev_size = m_requests.size();
+    const int rc = rpc_pack_req_into<FID>(
+        &m_requests, std::forward<Types>(args)...
     );
-    if (qvi_unlikely(zrc != 0)) {
-        const int eno = errno;
-        zerr_msg("zmq_setsockopt(ZMQ_RCVTIMEO) failed", eno);
-        return QV_RES_UNAVAILABLE;
-    }
-    // Now initiate the client/server exchange.
-    qvi_hwloc_flags_t hwloc_flags = QVI_HWLOC_FLAG_TOPO_FULL;
-    if (scope_flags & QV_SCOPE_FLAG_NO_SMT) {
-        hwloc_flags = QVI_HWLOC_FLAG_TOPO_NO_SMT;
-    }
-    std::string hwtopo_path;
-    int rc = m_hello(QVI_0xVERSION, hwloc_flags, hwtopo_path);
     if (qvi_unlikely(rc != QV_SUCCESS)) {
+        // Drop any partially packed request.
+        (void)m_requests.resize(prev_size);
         return rc;
     }
-    else {
-        m_connected = true;
-    }
-    // Now that we have all the info we need,
-    // finish populating the RMI config.
-    m_config.portno = portno;
-    m_config.url = url;
-    // Now we can initialize and load our topology.
-    rc = m_hwloc.topology_init(hwloc_flags, hwtopo_path);
-    if (qvi_unlikely(rc != QV_SUCCESS)) return QV_RES_UNAVAILABLE;
-
-    rc = m_hwloc.topology_load();
-    if (qvi_unlikely(rc != QV_SUCCESS)) return QV_RES_UNAVAILABLE;
-
+    m_unpackers.push_back(rpc_rep_unpacker<FID>(results));
     return QV_SUCCESS;
 }
 
 int
-qvi_rmi_client::m_recv_msg(
-    zmq_msg_t *mrx
-) const {
-    int qvrc = QV_SUCCESS;
-
-    int rc = zmq_msg_init(mrx);
-    if (qvi_unlikely(rc != 0)) {
-        const int eno = errno;
-        zerr_msg("zmq_msg_init() failed", eno);
-        return QV_ERR_RPC;
-    }
-    // Block until a message is available to be received from socket.
-    rc = zmq_msg_recv(mrx, m_zsock, 0);
-    if (qvi_unlikely(rc == -1)) {
-        const int eno = errno;
-        zerr_msg("zmq_msg_recv() failed", eno);
-        qvrc = QV_ERR_RPC;
-    }
-
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) zmq_msg_close(mrx);
-    return qvrc;
+qvi_rmi_batch::get_cpubind(
+    pid_t who,
+    qvi_hwloc_bitmap &cpuset
+) {
+    return m_add<QVI_RMI_FID_GET_CPUBIND>(
+        std::tie(cpuset), m_flags, who
+    );
 }
 
-template <typename... Types>
 int
-qvi_rmi_client::rpc_rep(
-    Types &&...args
-) const {
-    int rc = QV_SUCCESS;
-    zmq_msg_t msg;
+qvi_rmi_batch::set_cpubind(
+    pid_t who,
+    const qvi_hwloc_bitmap &cpuset
+) {
+    return m_add<QVI_RMI_FID_SET_CPUBIND>(
+        std::tie(), m_flags, who, cpuset
+    );
+}
 
-    do {
-        rc = m_recv_msg(&msg);
-        if (qvi_unlikely(rc != QV_SUCCESS)) break;
-        rc = rpc_unpack(zmq_msg_data(&msg), std::forward<Types>(args)...);
-    } while (false);
+int
+qvi_rmi_batch::get_intrinsic_hwpool(
+    const std::vector<pid_t> &who,
+    qv_scope_intrinsic_t iscope,
+    qv_scope_flags_t flags,
+    qvi_hwpool &hwpool
+) {
+    return m_add<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>(
+        std::tie(hwpool), m_flags, who, iscope, flags
+    );
+}
 
-    zmq_msg_close(&msg);
+int
+qvi_rmi_batch::get_obj_depth(
+    qv_hw_obj_type_t type,
+    int &depth
+) {
+    return m_add<QVI_RMI_FID_OBJ_TYPE_DEPTH>(
+        std::tie(depth), m_flags, type
+    );
+}
+
+int
+qvi_rmi_batch::get_nobjs_in_cpuset(
+    qv_hw_obj_type_t target_obj,
+    const qvi_hwloc_bitmap &cpuset,
+    size_t &nobjs
+) {
+    return m_add<QVI_RMI_FID_GET_NOBJS_IN_CPUSET>(
+        std::tie(nobjs), m_flags, target_obj, cpuset
+    );
+}
+
+int
+qvi_rmi_batch::get_device_in_cpuset(
+    qv_hw_obj_type_t dev_obj,
+    int dev_i,
+    const qvi_hwloc_bitmap &cpuset,
+    qv_device_id_type_t dev_id_type,
+    std::string &dev_id
+) {
+    return m_add<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>(
+        std::tie(dev_id),
+        m_flags, dev_obj, dev_i, cpuset, dev_id_type
+    );
+}
+
+int
+qvi_rmi_batch::get_cpuset_for_nobjs(
+    const qvi_hwloc_bitmap &cpuset,
+    qv_hw_obj_type_t obj_type,
+    int nobjs,
+    qvi_hwloc_bitmap &result
+) {
+    return m_add<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS>(
+        std::tie(result), m_flags, cpuset, obj_type, nobjs
+    );
+}
+
+int
+qvi_rmi_batch::execute(void)
+{
+    int rc = QV_SUCCESS;
+    if (!m_unpackers.empty()) {
+        rc = m_rmi.m_batch(*this);
+    }
+    (void)m_requests.resize(0);
+    m_unpackers.clear();
     return rc;
 }
 
+/**
+ * Returns the topology described by the provided server-published information
+ * as of the provided server generation. Topologies are read-only once loaded,
+ * so all the clients in this process that use the same one share a single
+ * instance.
+ */
+static int
+client_topology(
+    qvi_hwloc_flags_t flags,
+    const std::string &path,
+    const qvi_hwloc_shmem &shmem,
+    uint64_t generation,
+    std::shared_ptr<qvi_hwloc> &result
+) {
+    using key_t = std::tuple<
+        qvi_hwloc_flags_t, std::string, std::string, uint64_t
+    >;
+    static std::mutex mutex;
+    static std::map<key_t, std::weak_ptr<qvi_hwloc>> topologies;
+
+    const key_t key = {flags, path, shmem.path, generation};
+    // Held while loading so concurrent callers share one instance.
+    std::lock_guard<std::mutex> guard(mutex);
+    // Forget the topologies of previous generations no one uses anymore.
+    std::erase_if(topologies, [](const auto &entry) {
+        return entry.second.expired();
+    });
+    // Reuse a loaded topology, if there is one.
+    std::shared_ptr<qvi_hwloc> hwloc = topologies[key].lock();
+    if (hwloc) {
+        result = hwloc;
+        return QV_SUCCESS;
+    }
+    try {
+        hwloc = std::make_shared<qvi_hwloc>();
+    }
+    qvi_catch_and_return();
+    // Prefer adopting the server's topology from shared memory,
+    // which avoids parsing and keeping a private copy of it.
+    int rc = QV_ERR_HWLOC;
+    if (!shmem.path.empty()) {
+        rc = hwloc->topology_adopt(flags, shmem);
+    }
+    // Else initialize and load our topology.
+    if (rc != QV_SUCCESS) {
+        rc = hwloc->topology_init(flags, path);
+        if (qvi_unlikely(rc != QV_SUCCESS)) return QV_RES_UNAVAILABLE;
+
+        rc = hwloc->topology_load();
+        if (qvi_unlikely(rc != QV_SUCCESS)) return QV_RES_UNAVAILABLE;
+    }
+    result = hwloc;
+    topologies[key] = hwloc;
+    return QV_SUCCESS;
+}
+
+qvi_rmi_client::~qvi_rmi_client(void)
+{
+    for (auto &reply : m_replies) {
+        zmq_msg_close(&reply.second);
+    }
+    for (auto &request : m_outbox) {
+        qvi_delete(&request.second);
+    }
+    if (m_wakefd != -1) close(m_wakefd);
+    if (m_generation_word) {
+        (void)munmap(
+            (void *)m_generation_word, sysconf(_SC_PAGESIZE)
+        );
+    }
+    // Make sure we can safely call zmq_ctx_destroy(). Otherwise it will hang.
+    if (m_connected) {
+        zsocket_close(m_zsock);
+        zctx_destroy(&m_zctx);
+    }
+}
+
+std::shared_ptr<qvi_hwloc>
+qvi_rmi_client::hwloc(void)
+{
+    return m_topology();
+}
+
+std::shared_ptr<qvi_hwloc>
+qvi_rmi_client::m_topology(void) const
+{
+    m_check_generation();
+    uint64_t gen = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_cache_mutex);
+        gen = m_generation;
+    }
+    std::lock_guard<std::mutex> guard(m_hwloc_mutex);
+    // Without an exported topology, we have nothing newer to load.
+    if (qvi_likely(gen == m_hwloc_generation) || m_hwtopo_path.empty()) {
+        return m_hwloc;
+    }
+    std::shared_ptr<qvi_hwloc> hwloc;
+    const int rc = client_topology(
+        m_hwloc_flags, m_hwtopo_path, m_hwtopo_shmem, gen, hwloc
+    );
+    // Don't retry until the next generation.
+    m_hwloc_generation = gen;
+    if (qvi_unlikely(rc != QV_SUCCESS)) {
+        qvi_log_warn("Cannot load the current topology (rc={})", rc);
+        return m_hwloc;
+    }
+    // Whoever still uses the previous one keeps it alive.
+    m_hwloc = hwloc;
+    return m_hwloc;
+}
+
+/**
+ * Returns a key identifying a query with the provided arguments.
+ */
+template <typename... Types>
+static std::string
+cache_key(
+    Types &&...args
+) {
+    qvi_bbuff buff;
+    const int rc = buff.pack(std::forward<Types>(args)...);
+    if (qvi_unlikely(rc != QV_SUCCESS)) throw qvi_runtime_error(rc);
+    return std::string((const char *)buff.cdata(), buff.size());
+}
+
+void
+qvi_rmi_client::m_observe_generation(
+    uint64_t gen
+) const {
+    std::lock_guard<std::mutex> guard(m_cache_mutex);
+    // Replies may carry a generation older than one already seen.
+    if (qvi_likely(gen <= m_generation)) return;
+    // Whatever we cached describes a view of the hardware that is gone.
+    m_hwpool_cache.clear();
+    m_devid_cache.clear();
+    m_generation = gen;
+}
+
+void
+qvi_rmi_client::m_check_generation(void) const
+{
+    if (!m_generation_word) return;
+    m_observe_generation(m_generation_word->load(std::memory_order_acquire));
+}
+
+int
+qvi_rmi_client::m_map_generation(
+    const std::string &path
+) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (qvi_unlikely(fd == -1)) return QV_ERR_FILE_IO;
+    void *addr = mmap(
+        nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0
+    );
+    (void)close(fd);
+    if (qvi_unlikely(addr == MAP_FAILED)) return QV_ERR_FILE_IO;
+    m_generation_word = static_cast<const std::atomic<uint64_t> *>(addr);
+    return QV_SUCCESS;
+}
+
+template <typename Value>
+bool
+qvi_rmi_client::m_cache_get(
+    qvi_lru_cache<std::string, Value> &cache,
+    const std::string &key,
+    Value &value,
+    uint64_t &gen
+) const {
+    // Don't serve what the server has since invalidated.
+    m_check_generation();
+    std::lock_guard<std::mutex> guard(m_cache_mutex);
+    gen = m_generation;
+    Value cached;
+    if (cache.get(key, cached) != QV_SUCCESS) return false;
+    value = cached;
+    return true;
+}
+
+template <typename Value>
+void
+qvi_rmi_client::m_cache_put(
+    qvi_lru_cache<std::string, Value> &cache,
+    const std::string &key,
+    const Value &value,
+    uint64_t gen
+) const {
+    std::lock_guard<std::mutex> guard(m_cache_mutex);
+    // The view may have changed while the query was in flight.
+    if (gen != m_generation) return;
+    cache.put(key, value);
+}
+
+int
+qvi_rmi_client::discover(
+    int &portno
+) {
+    int rc = QV_SUCCESS;
+    // If this fails, envport is set to QVI_COMM_PORT_UNSET.
+    int envport = qvi_port_from_env();
+    // A connection port is requested via environment variable.
+    if (envport != QVI_PORT_UNSET) {
+        rc = qvi_session_discover(1024, envport);
+        // Found it!
+        if (rc == QV_SUCCESS) {
+            portno = envport;
+            return rc;
+        }
+    }
+    // Try to discover an arbitrary, active session.
+    return qvi_session_discover(1024, portno);
+}
+
+int
+qvi_rmi_client::connect(
+    qv_scope_flags_t scope_flags,
+    const std::string &url,
+    const int portno
+) {
+    // Create a new ZMQ context.
+    m_zctx = zmq_ctx_new();
+    if (qvi_unlikely(!m_zctx)) return QV_RES_UNAVAILABLE;
+    // Create the ZMQ socket used for communication with the server. Unlike
+    // REQ, DEALER lets us have several requests in flight at a time.
+    m_zsock = zsocket_create(m_zctx, ZMQ_DEALER);
+    if (qvi_unlikely(!m_zsock)) return QV_RES_UNAVAILABLE;
+    // Note: ZMQ_CONNECT_TIMEOUT doesn't seem to have an appreciable effect.
+    int zrc = zsocket_connect(m_zsock, url.c_str());
+    if (qvi_unlikely(zrc != 0)) {
+        const int eno = errno;
+        zerr_msg("zsocket_connect() failed", eno);
+        return QV_RES_UNAVAILABLE;
+    }
+    // To avoid hangs in faulty connections, set a timeout
+    // before initiating the first client/server exchange.
+    const int timeout_in_ms = s_recv_timeout_ms;
+    zrc = zmq_setsockopt(
+        m_zsock, ZMQ_RCVTIMEO, &timeout_in_ms, sizeof(timeout_in_ms)
+    );
+    if (qvi_unlikely(zrc != 0)) {
+        const int eno = errno;
+        zerr_msg("zmq_setsockopt(ZMQ_RCVTIMEO) failed", eno);
+        return QV_RES_UNAVAILABLE;
+    }
+    m_wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (qvi_unlikely(m_wakefd == -1)) {
+        const int eno = errno;
+        qvi_log_error(
+            "eventfd() failed with errno={} ({})", eno, strerror(eno)
+        );
+        return QV_ERR_SYS;
+    }
+    // Now initiate the client/server exchange.
+    qvi_hwloc_flags_t hwloc_flags = QVI_HWLOC_FLAG_TOPO_FULL;
+    if (scope_flags & QV_SCOPE_FLAG_NO_SMT) {
+        hwloc_flags = QVI_HWLOC_FLAG_TOPO_NO_SMT;
+    }
+    std::string hwtopo_path, generation_path;
+    qvi_hwloc_shmem hwtopo_shmem;
+    int rc = m_hello(
+        QVI_0xVERSION, hwloc_flags, hwtopo_path, hwtopo_shmem, generation_path
+    );
+    if (qvi_unlikely(rc != QV_SUCCESS)) {
+        return rc;
+    }
+    else {
+        m_connected = true;
+    }
+    // Without it, cached query results go stale until our next request.
+    if (!generation_path.empty()) {
+        rc = m_map_generation(generation_path);
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            qvi_log_debug("Cannot map {}", generation_path);
+        }
+    }
+    // Now that we have all the info we need,
+    // finish populating the RMI config.
+    m_config.portno = portno;
+    m_config.url = url;
+    // Remember where to find the topology should the server's view change.
+    m_hwloc_flags = hwloc_flags;
+    m_hwtopo_path = hwtopo_path;
+    m_hwtopo_shmem = hwtopo_shmem;
+    m_check_generation();
+    std::lock_guard<std::mutex> guard(m_hwloc_mutex);
+    {
+        std::lock_guard<std::mutex> cache_guard(m_cache_mutex);
+        m_hwloc_generation = m_generation;
+    }
+    return client_topology(
+        hwloc_flags, hwtopo_path, hwtopo_shmem, m_hwloc_generation, m_hwloc
+    );
+}
+
+int
+qvi_rmi_client::m_recv_msg(
+    zmq_msg_t *mrx
+) const {
+    int qvrc = QV_SUCCESS;
+
+    int rc = zmq_msg_init(mrx);
+    if (qvi_unlikely(rc != 0)) {
+        const int eno = errno;
+        zerr_msg("zmq_msg_init() failed", eno);
+        return QV_ERR_RPC;
+    }
+    // Replies are preceded by the empty delimiter frame that our DEALER socket
+    // sends ahead of each request, so skip over it to get to the reply itself.
+    do {
+        // Block until a message is available to be received from socket.
+        rc = zmq_msg_recv(mrx, m_zsock, 0);
+        if (qvi_unlikely(rc == -1)) {
+            const int eno = errno;
+            zerr_msg("zmq_msg_recv() failed", eno);
+            qvrc = QV_ERR_RPC;
+            break;
+        }
+    } while (zmq_msg_size(mrx) == 0 && zmq_msg_more(mrx));
+
+    if (qvi_unlikely(qvrc != QV_SUCCESS)) zmq_msg_close(mrx);
+    return qvrc;
+}
+
+int
+qvi_rmi_client::m_recv_reply(
+    uint64_t rid,
+    zmq_msg_t *mrx
+) const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    do {
+        // Did it arrive while another thread was receiving?
+        const auto got = m_replies.find(rid);
+        if (got != m_replies.end()) {
+            zmq_msg_init(mrx);
+            zmq_msg_move(mrx, &got->second);
+            zmq_msg_close(&got->second);
+            m_replies.erase(got);
+            return QV_SUCCESS;
+        }
+        if (qvi_unlikely(m_unsent.erase(rid) != 0)) return QV_ERR_RPC;
+        if (!m_receiving) break;
+        m_recv_cv.wait(lock);
+    } while (true);
+    // Nobody is receiving, so it is up to us.
+    m_receiving = true;
+    const int rc = m_recv_replies(rid, mrx, lock);
+    // Whatever was queued while we received still has to go out.
+    m_send_outbox();
+    m_receiving = false;
+    m_recv_cv.notify_all();
+    return rc;
+}
+
+int
+qvi_rmi_client::m_recv_replies(
+    uint64_t rid,
+    zmq_msg_t *mrx,
+    std::unique_lock<std::mutex> &lock
+) const {
+    zmq_pollitem_t items[] = {
+        {m_zsock, 0, ZMQ_POLLIN, 0},
+        {nullptr, m_wakefd, ZMQ_POLLIN, 0}
+    };
+    int timeout_ms = s_recv_timeout_ms;
+    do {
+        m_send_outbox();
+        // Let the other threads send and collect replies while we block.
+        lock.unlock();
+        const uint64_t start_ns = steady_ns();
+        const int nready = zmq_poll(items, 2, timeout_ms);
+        const int eno = errno;
+        lock.lock();
+        if (qvi_unlikely(nready == -1)) {
+            if (eno == EINTR) continue;
+            zerr_msg("zmq_poll() failed", eno);
+            m_abandoned.insert(rid);
+            return QV_ERR_RPC;
+        }
+        if (qvi_unlikely(nready == 0)) {
+            zerr_msg("zmq_poll() timed out", EAGAIN);
+            // Should the reply ever show up, drop it.
+            m_abandoned.insert(rid);
+            return QV_ERR_RPC;
+        }
+        if (items[1].revents & ZMQ_POLLIN) {
+            uint64_t nwakes = 0;
+            (void)!read(m_wakefd, &nwakes, sizeof(nwakes));
+        }
+        if (!(items[0].revents & ZMQ_POLLIN)) {
+            const int elapsed_ms = (steady_ns() - start_ns) / 1000000;
+            timeout_ms = std::max(0, timeout_ms - elapsed_ms);
+            continue;
+        }
+        timeout_ms = s_recv_timeout_ms;
+        // Replies arrive in whatever order the server's workers complete
+        // them. A whole message is ready, so this does not block.
+        const int rc = m_recv_msg(mrx);
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            m_abandoned.insert(rid);
+            return rc;
+        }
+        qvi_rmi_msg_header hdr;
+        unpack_msg_header(zmq_msg_data(mrx), &hdr);
+        m_observe_generation(hdr.gen);
+        if (hdr.rid == rid) return QV_SUCCESS;
+        // Not ours. Keep it for its waiter, unless there is none.
+        if (m_abandoned.erase(hdr.rid) == 0) {
+            zmq_msg_t &stashed = m_replies[hdr.rid];
+            zmq_msg_init(&stashed);
+            zmq_msg_move(&stashed, mrx);
+            m_recv_cv.notify_all();
+        }
+        zmq_msg_close(mrx);
+    } while (true);
+}
+
+void
+qvi_rmi_client::m_abandon(
+    uint64_t rid
+) const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    const auto got = m_replies.find(rid);
+    if (got != m_replies.end()) {
+        zmq_msg_close(&got->second);
+        m_replies.erase(got);
+        return;
+    }
+    if (m_unsent.erase(rid) != 0) return;
+    m_abandoned.insert(rid);
+}
+
+int
+qvi_rmi_client::m_send(
+    qvi_bbuff *bbuff,
+    uint64_t &rid
+) const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    rid = m_next_rid++;
+    buffer_set_rid(bbuff, rid);
+    if (!m_receiving) return m_send_msg(bbuff);
+    // The socket is in use by the receiving thread, so have it send this.
+    m_outbox.emplace_back(rid, bbuff);
+    const uint64_t nwakes = 1;
+    if (qvi_unlikely(write(m_wakefd, &nwakes, sizeof(nwakes)) == -1)) {
+        const int eno = errno;
+        qvi_log_error("write() failed with errno={} ({})", eno, strerror(eno));
+        // It still goes out once the receiving thread is done.
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_rmi_client::m_send_msg(
+    qvi_bbuff *bbuff
+) const {
+    // Our DEALER socket must supply the delimiter a REQ socket would have.
+    const int zrc = zmq_send(m_zsock, nullptr, 0, ZMQ_SNDMORE);
+    if (qvi_unlikely(zrc == -1)) {
+        const int eno = errno;
+        zerr_msg("zmq_send() failed", eno);
+        qvi_delete(&bbuff);
+        return QV_ERR_RPC;
+    }
+    int bsent = 0;
+    return zsock_send_bbuff(m_zsock, bbuff, &bsent);
+}
+
+void
+qvi_rmi_client::m_send_outbox(void) const
+{
+    for (auto &request : m_outbox) {
+        const int rc = m_send_msg(request.second);
+        // Let its waiter know that no reply is coming.
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            m_unsent.insert(request.first);
+            m_recv_cv.notify_all();
+        }
+    }
+    m_outbox.clear();
+}
+
 template <typename... Types>
 int
 qvi_rmi_client::rpc_req(
+    uint64_t &rid,
     qvi_rmi_rpc_fid_t fid,
     Types &&...args
 ) const {
@@ -436,26 +1150,150 @@ qvi_rmi_client::rpc_req(
         qvi_delete(&bbuff);
         return rc;
     }
-    int bsent = 0;
-    return zsock_send_bbuff(m_zsock, bbuff, &bsent);
+    return m_send(bbuff, rid);
+}
+
+template <qvi_rmi_rpc_fid_t FID, typename... Results, typename... Types>
+int
+qvi_rmi_client::m_issue(
+    qvi_rmi_future &future,
+    std::tuple<Results &...> results,
+    Types &&...args
+) const {
+    // Reusing a token discards the results of its previous RPC.
+    future.m_abandon();
+
+    static_assert(
+        rpc_types_match<typename qvi_rmi_rpc_schema<FID>::args, Types...>,
+        "RPC arguments do not match the RPC's schema"
+    );
+    uint64_t rid = 0;
+    const int rc = rpc_req(rid, FID, std::forward<Types>(args)...);
+    future.m_rmi = this;
+    future.m_rid = rid;
+    future.m_unpacker = rpc_rep_unpacker<FID>(results);
+    future.m_pending = (rc == QV_SUCCESS);
+    future.m_rc = rc;
+    return rc;
+}
+
+int
+qvi_rmi_client::m_complete(
+    qvi_rmi_future &future,
+    int rc
+) const {
+    future.m_abandon();
+    future.m_rmi = this;
+    future.m_pending = false;
+    future.m_rc = rc;
+    return QV_SUCCESS;
+}
+
+qvi_rmi_future::~qvi_rmi_future(void)
+{
+    m_abandon();
+}
+
+void
+qvi_rmi_future::m_abandon(void)
+{
+    if (m_pending) m_rmi->m_abandon(m_rid);
+    m_pending = false;
+}
+
+bool
+qvi_rmi_future::pending(void) const
+{
+    return m_pending;
+}
+
+int
+qvi_rmi_future::wait(void)
+{
+    if (!m_pending) return m_rc;
+    m_pending = false;
+
+    zmq_msg_t msg;
+    m_rc = m_rmi->m_recv_reply(m_rid, &msg);
+    if (qvi_unlikely(m_rc != QV_SUCCESS)) return m_rc;
+
+    m_rc = m_unpacker(zmq_msg_data(&msg));
+    zmq_msg_close(&msg);
+    return m_rc;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Client-Side RPC Definitions
 ////////////////////////////////////////////////////////////////////////////////
+int
+qvi_rmi_client::m_batch(
+    qvi_rmi_batch &batch
+) const {
+    const size_t nops = batch.size();
+    // The batched requests follow the batch's own header and body.
+    qvi_bbuff *bbuff = nullptr;
+    int rc = rpc_pack(&bbuff, QVI_RMI_FID_BATCH, nops);
+    if (qvi_unlikely(rc != QV_SUCCESS)) {
+        qvi_delete(&bbuff);
+        return rc;
+    }
+    rc = bbuff->append(batch.m_requests.cdata(), batch.m_requests.size());
+    if (qvi_unlikely(rc != QV_SUCCESS)) {
+        qvi_delete(&bbuff);
+        return rc;
+    }
+    uint64_t rid = 0;
+    rc = m_send(bbuff, rid);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+    zmq_msg_t msg;
+    rc = m_recv_reply(rid, &msg);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+    byte_t *data = (byte_t *)zmq_msg_data(&msg);
+    // The batch-wide status, then each operation's reply, in request order.
+    rc = rpc_unpack_rep(data);
+    if (qvi_likely(rc == QV_SUCCESS)) {
+        int oprc = QV_SUCCESS;
+        for (const auto &unpacker : batch.m_unpackers) {
+            data += rpc_msg_size(data);
+            oprc = unpacker(data);
+            if (qvi_unlikely(oprc != QV_SUCCESS && rc == QV_SUCCESS)) {
+                rc = oprc;
+            }
+        }
+    }
+    zmq_msg_close(&msg);
+    return rc;
+}
+
 int
 qvi_rmi_client::m_hello(
     size_t client_version,
     qvi_hwloc_flags_t flags,
-    std::string &hwtopo_path
+    std::string &hwtopo_path,
+    qvi_hwloc_shmem &hwtopo_shmem,
+    std::string &generation_path
 ) {
-    int qvrc = rpc_req(QVI_RMI_FID_HELLO, client_version, flags, qvi_gettid());
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc, hwtopo_path);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
+    qvi_rmi_future future;
+    const int rc = m_issue<QVI_RMI_FID_HELLO>(
+        future, std::tie(hwtopo_path, hwtopo_shmem, generation_path),
+        client_version, flags, qvi_gettid()
+    );
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return future.wait();
+}
+
+int
+qvi_rmi_client::get_cpubind_async(
+    pid_t who,
+    qvi_hwloc_bitmap &cpuset,
+    qvi_rmi_future &future
+) const {
+    return m_issue<QVI_RMI_FID_GET_CPUBIND>(
+        future,
+        std::tie(cpuset), m_hwloc_flags, who
+    );
 }
 
 int
@@ -463,13 +1301,54 @@ qvi_rmi_client::get_cpubind(
     pid_t who,
     qvi_hwloc_bitmap &cpuset
 ) const {
-    int qvrc = rpc_req(QVI_RMI_FID_GET_CPUBIND, m_hwloc.flags(), who);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc, cpuset);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
+    qvi_rmi_future future;
+    const int rc = get_cpubind_async(who, cpuset, future);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return future.wait();
+}
+
+int
+qvi_rmi_client::get_my_cpubind(
+    qvi_hwloc_bitmap &cpuset
+) {
+    const pid_t me = qvi_gettid();
+    // Our topology describes this system, so
+    // we can skip the round trip to the server.
+    const std::shared_ptr<qvi_hwloc> hwloc = m_topology();
+    if (qvi_likely(hwloc->topology_is_this_system())) {
+        const int rc = hwloc->task_get_cpubind(me, cpuset);
+        if (qvi_likely(rc == QV_SUCCESS)) return rc;
+    }
+    return get_cpubind(me, cpuset);
+}
+
+int
+qvi_rmi_client::set_my_cpubind(
+    const qvi_hwloc_bitmap &cpuset
+) {
+    const pid_t me = qvi_gettid();
+    // Binding ourselves needs no special privileges, so
+    // only involve the server when we cannot do it directly.
+    const std::shared_ptr<qvi_hwloc> hwloc = m_topology();
+    if (qvi_likely(hwloc->topology_is_this_system())) {
+        const int rc = hwloc->task_set_cpubind_from_cpuset(
+            me, cpuset.cdata()
+        );
+        if (qvi_likely(rc == QV_SUCCESS)) return rc;
+    }
+    return set_cpubind(me, cpuset);
+}
+
+int
+qvi_rmi_client::set_cpubind_async(
+    pid_t who,
+    const qvi_hwloc_bitmap &cpuset,
+    qvi_rmi_future &future
+) const {
+    return m_issue<QVI_RMI_FID_SET_CPUBIND>(
+        future,
+        std::tie(), m_hwloc_flags, who, cpuset
+    );
 }
 
 int
@@ -477,13 +1356,98 @@ qvi_rmi_client::set_cpubind(
     pid_t who,
     const qvi_hwloc_bitmap &cpuset
 ) {
-    int qvrc = rpc_req(QVI_RMI_FID_SET_CPUBIND, m_hwloc.flags(), who, cpuset);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
+    bind_request request;
+    request.who = who;
+    request.cpuset = &cpuset;
+
+    std::unique_lock<std::mutex> lock(m_bind_mutex);
+    m_bind_queue.push_back(&request);
+    // Wait for another thread to complete our request or for our turn.
+    m_bind_cv.wait(lock, [&] { return request.done || !m_binding; });
+    if (request.done) return request.rc;
+    // Send all the requests queued so far, ours included, at once.
+    m_binding = true;
+    std::vector<bind_request *> requests;
+    requests.swap(m_bind_queue);
+    lock.unlock();
+
+    std::vector<int> rcs;
+    int rc = QV_SUCCESS;
+    qvi_rmi_future future;
+    if (requests.size() == 1) {
+        rc = set_cpubind_async(who, cpuset, future);
+        if (qvi_likely(rc == QV_SUCCESS)) rc = future.wait();
+        rcs.push_back(rc);
+    }
+    else {
+        try {
+            std::vector<pid_t> who_many;
+            std::vector<qvi_hwloc_bitmap> cpusets;
+            for (const auto req : requests) {
+                who_many.push_back(req->who);
+                cpusets.push_back(*req->cpuset);
+            }
+            rc = set_cpubind_async(who_many, cpusets, rcs, future);
+            if (qvi_likely(rc == QV_SUCCESS)) rc = future.wait();
+        }
+        catch (const std::bad_alloc &) {
+            rc = QV_ERR_OOR;
+        }
+        // Without per-task return codes, every request failed.
+        if (rcs.size() != requests.size()) {
+            if (rc == QV_SUCCESS) rc = QV_ERR_RPC;
+            rcs.assign(requests.size(), rc);
+        }
+    }
+
+    lock.lock();
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i]->rc = rcs[i];
+        requests[i]->done = true;
+    }
+    m_binding = false;
+    lock.unlock();
+    m_bind_cv.notify_all();
+    return request.rc;
+}
+
+int
+qvi_rmi_client::set_cpubind_async(
+    const std::vector<pid_t> &who,
+    const std::vector<qvi_hwloc_bitmap> &cpusets,
+    std::vector<int> &rcs,
+    qvi_rmi_future &future
+) const {
+    if (qvi_unlikely(who.size() != cpusets.size())) return QV_ERR_INVLD_ARG;
+    return m_issue<QVI_RMI_FID_SET_CPUBIND_MANY>(
+        future, std::tie(rcs), m_hwloc_flags, who, cpusets
+    );
+}
+
+int
+qvi_rmi_client::set_cpubind(
+    const std::vector<pid_t> &who,
+    const std::vector<qvi_hwloc_bitmap> &cpusets
+) {
+    std::vector<int> rcs;
+    qvi_rmi_future future;
+    const int rc = set_cpubind_async(who, cpusets, rcs, future);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return future.wait();
+}
+
+int
+qvi_rmi_client::get_intrinsic_hwpool_async(
+    const std::vector<pid_t> &who,
+    qv_scope_intrinsic_t iscope,
+    qv_scope_flags_t flags,
+    qvi_hwpool &hwpool,
+    qvi_rmi_future &future
+) const {
+    return m_issue<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>(
+        future,
+        std::tie(hwpool), m_hwloc_flags, who, iscope, flags
+    );
 }
 
 int
@@ -493,49 +1457,95 @@ qvi_rmi_client::get_intrinsic_hwpool(
     qv_scope_flags_t flags,
     qvi_hwpool &hwpool
 ) {
-    int qvrc = rpc_req(
-        QVI_RMI_FID_GET_INTRINSIC_HWPOOL,
-        m_hwloc.flags(), who, iscope, flags
+    // The user pool only depends on the server's view of the hardware, while
+    // the others follow the current bindings of their members.
+    const bool cacheable = (iscope == QV_SCOPE_USER);
+    const std::string key = cacheable ?
+        cache_key(m_hwloc_flags, flags) : std::string();
+    uint64_t gen = 0;
+    if (cacheable && m_cache_get(m_hwpool_cache, key, hwpool, gen)) {
+        return QV_SUCCESS;
+    }
+
+    qvi_rmi_future future;
+    int rc = get_intrinsic_hwpool_async(
+        who, iscope, flags, hwpool, future
+    );
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    rc = future.wait();
+    if (cacheable && qvi_likely(rc == QV_SUCCESS)) {
+        m_cache_put(m_hwpool_cache, key, hwpool, gen);
+    }
+    return rc;
+}
+
+int
+qvi_rmi_client::get_obj_depth_async(
+    qv_hw_obj_type_t type,
+    int &depth,
+    qvi_rmi_future &future
+) const {
+    return m_complete(future, m_topology()->obj_type_depth(type, &depth));
+}
+
+int
+qvi_rmi_client::get_obj_depth(
+    qv_hw_obj_type_t type,
+    int &depth
+) {
+    return m_topology()->obj_type_depth(type, &depth);
+}
+
+int
+qvi_rmi_client::get_nobjs_in_cpuset_async(
+    qv_hw_obj_type_t target_obj,
+    const qvi_hwloc_bitmap &cpuset,
+    size_t &nobjs,
+    qvi_rmi_future &future
+) const {
+    return m_complete(
+        future,
+        m_topology()->get_nobjs_in_cpuset(target_obj, cpuset.cdata(), nobjs)
     );
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    // Get the new hardware pool.
-    qvrc = rpc_rep(rpcrc, hwpool);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
 }
 
 int
-qvi_rmi_client::get_obj_depth(
-    qv_hw_obj_type_t type,
-    int &depth
+qvi_rmi_client::get_nobjs_in_cpuset(
+    qv_hw_obj_type_t target_obj,
+    const qvi_hwloc_bitmap &cpuset,
+    size_t &nobjs
 ) {
-    int qvrc = rpc_req(QVI_RMI_FID_OBJ_TYPE_DEPTH, m_hwloc.flags(), type);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc, depth);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
+    return m_topology()->get_nobjs_in_cpuset(target_obj, cpuset.cdata(), nobjs);
 }
 
 int
 qvi_rmi_client::get_nobjs_in_cpuset(
-    qv_hw_obj_type_t target_obj,
+    const std::vector<qv_hw_obj_type_t> &target_objs,
     const qvi_hwloc_bitmap &cpuset,
-    size_t &nobjs
+    std::vector<size_t> &nobjs
 ) {
-    int qvrc = rpc_req(
-        QVI_RMI_FID_GET_NOBJS_IN_CPUSET,
-        m_hwloc.flags(), target_obj, cpuset
+    nobjs.assign(target_objs.size(), 0);
+    for (size_t i = 0; i < target_objs.size(); ++i) {
+        const int rc = get_nobjs_in_cpuset(target_objs[i], cpuset, nobjs[i]);
+        if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_rmi_client::get_device_in_cpuset_async(
+    qv_hw_obj_type_t dev_obj,
+    int dev_i,
+    const qvi_hwloc_bitmap &cpuset,
+    qv_device_id_type_t dev_id_type,
+    std::string &dev_id,
+    qvi_rmi_future &future
+) const {
+    return m_issue<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>(
+        future,
+        std::tie(dev_id),
+        m_hwloc_flags, dev_obj, dev_i, cpuset, dev_id_type
     );
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc, nobjs);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
 }
 
 int
@@ -546,16 +1556,36 @@ qvi_rmi_client::get_device_in_cpuset(
     qv_device_id_type_t dev_id_type,
     std::string &dev_id
 ) {
-    int qvrc = rpc_req(
-        QVI_RMI_FID_GET_DEVICE_IN_CPUSET,
-        m_hwloc.flags(), dev_obj, dev_i, cpuset, dev_id_type
+    const std::string key = cache_key(
+        m_hwloc_flags, dev_obj, dev_i, cpuset, dev_id_type
+    );
+    uint64_t gen = 0;
+    if (m_cache_get(m_devid_cache, key, dev_id, gen)) return QV_SUCCESS;
+
+    qvi_rmi_future future;
+    int rc = get_device_in_cpuset_async(
+        dev_obj, dev_i, cpuset, dev_id_type, dev_id, future
+    );
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    rc = future.wait();
+    if (qvi_likely(rc == QV_SUCCESS)) {
+        m_cache_put(m_devid_cache, key, dev_id, gen);
+    }
+    return rc;
+}
+
+int
+qvi_rmi_client::get_cpuset_for_nobjs_async(
+    const qvi_hwloc_bitmap &cpuset,
+    qv_hw_obj_type_t obj_type,
+    int nobjs,
+    qvi_hwloc_bitmap &result,
+    qvi_rmi_future &future
+) const {
+    return m_complete(
+        future,
+        m_topology()->get_cpuset_for_nobjs(cpuset, obj_type, nobjs, result)
     );
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc, dev_id);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
 }
 
 int
@@ -565,71 +1595,113 @@ qvi_rmi_client::get_cpuset_for_nobjs(
     int nobjs,
     qvi_hwloc_bitmap &result
 ) {
-    int qvrc = rpc_req(
-        QVI_RMI_FID_GET_CPUSET_FOR_NOBJS,
-        m_hwloc.flags(), cpuset, obj_type, nobjs
+    return m_topology()->get_cpuset_for_nobjs(cpuset, obj_type, nobjs, result);
+}
+
+int
+qvi_rmi_client::reserve(
+    const qvi_hwloc_bitmap &cpuset,
+    qv_hw_obj_type_t obj_type,
+    int nobjs,
+    uint64_t &lease,
+    qvi_hwpool &hwpool
+) const {
+    qvi_rmi_future future;
+    const int rc = m_issue<QVI_RMI_FID_RESERVE>(
+        future, std::tie(lease, hwpool),
+        m_hwloc_flags, getpid(), cpuset, obj_type, nobjs
     );
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    // Should be set by rpc_rep, so assume an error.
-    int rpcrc = QV_ERR_RPC;
-    qvrc = rpc_rep(rpcrc, result);
-    if (qvi_unlikely(qvrc != QV_SUCCESS)) return qvrc;
-    return rpcrc;
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return future.wait();
+}
+
+int
+qvi_rmi_client::release(
+    uint64_t lease
+) const {
+    qvi_rmi_future future;
+    const int rc = m_issue<QVI_RMI_FID_RELEASE>(
+        future, std::tie(), getpid(), lease
+    );
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return future.wait();
+}
+
+int
+qvi_rmi_client::get_stats(
+    std::vector<qvi_rmi_rpc_stats> &stats
+) const {
+    qvi_rmi_future future;
+    const int rc = m_issue<QVI_RMI_FID_STATS>(future, std::tie(stats));
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    return future.wait();
 }
 
 int
 qvi_rmi_client::send_shutdown_message(void)
 {
-    return rpc_req(QVI_RMI_FID_SERVER_SHUTDOWN);
+    // We won't wait for the reply, so don't hold on to it.
+    uint64_t rid = 0;
+    const int rc = rpc_req(rid, QVI_RMI_FID_SERVER_SHUTDOWN);
+    if (qvi_likely(rc == QV_SUCCESS)) m_abandon(rid);
+    return rc;
 }
 
 qvi_rmi_server::qvi_rmi_server(void)
 {
-    // Register signal handlers.
-    struct sigaction action = {};
-    action.sa_handler = server_signal_handler;
-
-    sigaction(SIGTERM, &action, nullptr);
-    sigaction(SIGINT, &action, nullptr);
-    sigaction(SIGHUP, &action, nullptr);
-
-    m_rpc_dispatch_table = {
-        {QVI_RMI_FID_INVALID, s_rpc_invalid},
-        {QVI_RMI_FID_SERVER_SHUTDOWN, s_rpc_shutdown},
-        {QVI_RMI_FID_HELLO, s_rpc_hello},
-        {QVI_RMI_FID_GET_CPUBIND, s_rpc_get_cpubind},
-        {QVI_RMI_FID_SET_CPUBIND, s_rpc_set_cpubind},
-        {QVI_RMI_FID_OBJ_TYPE_DEPTH, s_rpc_obj_type_depth},
-        {QVI_RMI_FID_GET_NOBJS_IN_CPUSET, s_rpc_get_nobjs_in_cpuset},
-        {QVI_RMI_FID_GET_CPUSET_FOR_NOBJS, s_rpc_get_cpuset_for_nobjs},
-        {QVI_RMI_FID_GET_DEVICE_IN_CPUSET, s_rpc_get_device_in_cpuset},
-        {QVI_RMI_FID_GET_INTRINSIC_HWPOOL, s_rpc_get_intrinsic_hwpool}
-    };
+    // Our signals are received through a signalfd in the main loop, so they
+    // must stay pending instead of being delivered. Block them here, before
+    // any thread that would inherit a mask without them is started.
+    const sigset_t sigs = server_signals();
+    const int prc = pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
+    if (qvi_unlikely(prc != 0)) {
+        qvi_log_error("pthread_sigmask() failed with rc={}", prc);
+        throw qvi_runtime_error(QV_ERR_SYS);
+    }
 
-    for (const auto topo_type : qvi_hwloc::topo_types()) {
-        auto &hwloc = m_hwlocs.get(topo_type);
+    // Discover the hardware only once, reusing the full topology discovered
+    // by a previous server when possible. The other types are views of it.
+    const qvi_hwloc_flags_t full_type = QVI_HWLOC_FLAG_TOPO_FULL;
+    auto &full = m_hwlocs.get(full_type);
+    int qvrc = full.topology_load_cached(full_type, topo_cache_dir());
+    if (qvi_unlikely(qvrc != QV_SUCCESS)) {
+        static cstr_t ers = "hwloc.topology_load_cached() failed";
+        qvi_log_error("{} (rc={}, {})", ers, qvrc, qv_strerr(qvrc));
+        throw qvi_runtime_error(qvrc);
+    }
 
-        int qvrc = hwloc.topology_init(topo_type);
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            static cstr_t ers = "hwloc.topology_init() failed";
-            qvi_log_error("{} (rc={}, {})", ers, qvrc, qv_strerr(qvrc));
-            throw qvi_runtime_error(qvrc);
-        }
+    for (const auto topo_type : qvi_hwloc::topo_types()) {
+        if (topo_type == full_type) continue;
 
-        qvrc = hwloc.topology_load();
+        qvrc = m_hwlocs.get(topo_type).topology_derive(topo_type, full);
         if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            static cstr_t ers = "hwloc.topology_load() failed";
+            static cstr_t ers = "hwloc.topology_derive() failed";
             qvi_log_error("{} (rc={}, {})", ers, qvrc, qv_strerr(qvrc));
             throw qvi_runtime_error(qvrc);
         }
     }
 
+    // Start past any generation a previous server could have reached, so that
+    // clients of a restarted server do not mistake its view for the old one.
+    m_generation = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+
     m_zctx = zmq_ctx_new();
     if (qvi_unlikely(!m_zctx)) throw qvi_runtime_error(QV_ERR_SYS);
 }
 
 qvi_rmi_server::~qvi_rmi_server(void)
 {
+    m_stop_workers();
+    if (m_sigfd != -1) (void)close(m_sigfd);
+    if (m_hwwatch_fd != -1) (void)close(m_hwwatch_fd);
+    if (m_generation_word) {
+        (void)munmap(m_generation_word, sysconf(_SC_PAGESIZE));
+        (void)unlink(m_generation_path.c_str());
+    }
+    zsocket_close(m_zcontrol);
+    zsocket_close(m_zworkers);
     zsocket_close(m_zsock);
     zctx_destroy(&m_zctx);
 }
@@ -674,56 +1746,208 @@ qvi_rmi_server::m_get_iscope_bitmap_proc(
     return m_hwlocs.get(flags).task_get_cpubind(who[0], bitmap);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Server-Side RPC Definitions
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * Upper bound on the number of replies a server memoizes. Beyond it, replies
+ * are only shared by requests in flight.
+ */
+static constexpr size_t max_memoized_replies = 4096;
+
+template <qvi_rmi_rpc_fid_t FID>
+qvi_rmi_reply_reuse
+qvi_rmi_server::s_reply_reuse(
+    const typename qvi_rmi_rpc_schema<FID>::args &
+) {
+    return QVI_RMI_REPLY_REUSE_NONE;
+}
+
+template <qvi_rmi_rpc_fid_t FID>
+void
+qvi_rmi_server::s_rpc_caller(
+    const qvi_rmi_msg_header &,
+    typename qvi_rmi_rpc_schema<FID>::args &
+) { }
+
+template <>
+void
+qvi_rmi_server::s_rpc_caller<QVI_RMI_FID_RESERVE>(
+    const qvi_rmi_msg_header &hdr,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_RESERVE>::args &args
+) {
+    if (hdr.peer != 0) std::get<1>(args) = hdr.peer;
+}
+
+template <>
+void
+qvi_rmi_server::s_rpc_caller<QVI_RMI_FID_RELEASE>(
+    const qvi_rmi_msg_header &hdr,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_RELEASE>::args &args
+) {
+    if (hdr.peer != 0) std::get<0>(args) = hdr.peer;
+}
+
+template <>
+qvi_rmi_reply_reuse
+qvi_rmi_server::s_reply_reuse<QVI_RMI_FID_OBJ_TYPE_DEPTH>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_OBJ_TYPE_DEPTH>::args &
+) {
+    return QVI_RMI_REPLY_REUSE_MEMOIZE;
+}
+
+template <>
+qvi_rmi_reply_reuse
+qvi_rmi_server::s_reply_reuse<QVI_RMI_FID_GET_NOBJS_IN_CPUSET>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_NOBJS_IN_CPUSET>::args &
+) {
+    return QVI_RMI_REPLY_REUSE_MEMOIZE;
+}
+
+template <>
+qvi_rmi_reply_reuse
+qvi_rmi_server::s_reply_reuse<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS>::args &
+) {
+    return QVI_RMI_REPLY_REUSE_MEMOIZE;
+}
+
+template <>
+qvi_rmi_reply_reuse
+qvi_rmi_server::s_reply_reuse<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>::args &
+) {
+    return QVI_RMI_REPLY_REUSE_MEMOIZE;
+}
+
+template <>
+qvi_rmi_reply_reuse
+qvi_rmi_server::s_reply_reuse<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>::args &args
+) {
+    // Job and process pools follow the current bindings of their members, so
+    // they may only be shared by requests issued at the same time.
+    const qv_scope_intrinsic_t iscope = std::get<2>(args);
+    if (iscope == QV_SCOPE_USER) return QVI_RMI_REPLY_REUSE_MEMOIZE;
+    return QVI_RMI_REPLY_REUSE_COALESCE;
+}
+
+template <typename Service>
+int
+qvi_rmi_server::m_rpc_shared(
+    std::string &&key,
+    qvi_rmi_reply_reuse reuse,
+    Service &&service,
+    qvi_bbuff **output
+) {
+    std::shared_ptr<qvi_rmi_shared_reply> shared;
+    bool leader = false;
+    {
+        std::lock_guard<std::mutex> guard(m_replies_mutex);
+        auto &entry = m_replies[key];
+        if (!entry) {
+            entry = std::make_shared<qvi_rmi_shared_reply>();
+            leader = true;
+        }
+        shared = entry;
+    }
+
+    bool reusable = false;
+    if (!leader) {
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->cv.wait(lock, [&shared] { return shared->ready; });
+        // The worker that serviced the request failed, so try on our own.
+        if (qvi_unlikely(shared->rc != QV_SUCCESS)) {
+            lock.unlock();
+            return service(output, reusable);
+        }
+        int rc = qvi_new(output);
+        if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+        rc = (*output)->append(shared->reply.cdata(), shared->reply.size());
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            qvi_delete(output);
+            return rc;
+        }
+        m_replies_reused.fetch_add(1, std::memory_order_relaxed);
+        return QV_SUCCESS;
+    }
+
+    const int rc = service(output, reusable);
+    int src = rc;
+    {
+        std::lock_guard<std::mutex> guard(shared->mutex);
+        if (qvi_likely(src == QV_SUCCESS)) {
+            src = shared->reply.append((*output)->cdata(), (*output)->size());
+        }
+        shared->rc = src;
+        shared->ready = true;
+    }
+    shared->cv.notify_all();
+    // Waiters hold their own references, so the reply can go right away.
+    const bool keep = reuse == QVI_RMI_REPLY_REUSE_MEMOIZE &&
+                      reusable && src == QV_SUCCESS;
+    std::lock_guard<std::mutex> guard(m_replies_mutex);
+    if (!keep || m_replies.size() > max_memoized_replies) {
+        m_replies.erase(key);
+    }
+    return rc;
+}
+
+template <qvi_rmi_rpc_fid_t FID>
 int
-qvi_rmi_server::s_rpc_get_intrinsic_hwpool(
+qvi_rmi_server::s_rpc(
     qvi_rmi_server *server,
     qvi_rmi_msg_header *hdr,
     void *input,
     qvi_bbuff **output
 ) {
-    int rpcrc = QV_SUCCESS;
-    // Bitmap that encodes available host resources.
-    qvi_hwloc_bitmap sbitmap;
-    qvi_hwpool hwpool;
+    using schema = qvi_rmi_rpc_schema<FID>;
 
-    do {
-        qvi_hwloc_flags_t hwloc_flags;
-        std::vector<pid_t> who;
-        qv_scope_intrinsic_t iscope = {};
-        qv_scope_flags_t scope_flags;
-        rpcrc = qvi_bbuff::unpack(input, hwloc_flags, who, iscope, scope_flags);
-        // Drop the message. Send an empty hardware pool with the error code.
-        if (qvi_unlikely(rpcrc != QV_SUCCESS)) break;
-
-        switch (iscope) {
-            case QV_SCOPE_SYSTEM:
-                rpcrc = QV_ERR_NOT_SUPPORTED;
-                break;
-            case QV_SCOPE_USER:
-                rpcrc = server->m_get_iscope_bitmap_user(hwloc_flags, sbitmap);
-                break;
-            case QV_SCOPE_JOB:
-                rpcrc = server->m_get_iscope_bitmap_job(hwloc_flags, who, sbitmap);
-                break;
-            case QV_SCOPE_PROCESS:
-                rpcrc = server->m_get_iscope_bitmap_proc(hwloc_flags, who, sbitmap);
-                break;
-            [[unlikely]] default:
-                rpcrc = QV_ERR_INVLD_ARG;
-                break;
+    typename schema::args args;
+    int rpcrc = QV_SUCCESS;
+    if constexpr (std::tuple_size_v<typename schema::args> != 0) {
+        rpcrc = std::apply(
+            [input](auto &...as) { return qvi_bbuff::unpack(input, as...); },
+            args
+        );
+        if (qvi_likely(rpcrc == QV_SUCCESS)) s_rpc_caller<FID>(*hdr, args);
+    }
+    // Only successful replies may be memoized.
+    auto service = [server, &args, rpcrc](qvi_bbuff **out, bool &reusable) {
+        typename schema::results results;
+        int srpcrc = rpcrc;
+        // Send default results with the error code.
+        if (qvi_likely(srpcrc == QV_SUCCESS)) {
+            srpcrc = server->m_rpc<FID>(args, results);
         }
-        if (qvi_unlikely(rpcrc != QV_SUCCESS)) break;
-        rpcrc = hwpool.populate(server->m_hwlocs.get(hwloc_flags), sbitmap);
-    } while (false);
-
-    return rpc_pack(output, hdr->fid, rpcrc, hwpool);
+        reusable = (srpcrc == QV_SUCCESS);
+        return std::apply(
+            [out, srpcrc](auto &...rs) {
+                return rpc_pack(out, FID, srpcrc, rs...);
+            },
+            results
+        );
+    };
+    qvi_rmi_reply_reuse reuse = QVI_RMI_REPLY_REUSE_NONE;
+    if constexpr (std::tuple_size_v<typename schema::args> != 0) {
+        if (qvi_likely(rpcrc == QV_SUCCESS)) reuse = s_reply_reuse<FID>(args);
+    }
+    if (reuse == QVI_RMI_REPLY_REUSE_NONE) {
+        bool reusable = false;
+        return service(output, reusable);
+    }
+    // Identical requests have identical bodies. The header is left out, since
+    // it carries per-request information.
+    const qvi_rmi_rpc_fid_t fid = FID;
+    std::string key((const char *)&fid, sizeof(fid));
+    key.append((const char *)input, packed_size(input));
+    return server->m_rpc_shared(std::move(key), reuse, service, output);
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// Server-Side RPC Definitions
-////////////////////////////////////////////////////////////////////////////////
+template <>
 int
-qvi_rmi_server::s_rpc_invalid(
+qvi_rmi_server::s_rpc<QVI_RMI_FID_INVALID>(
     qvi_rmi_server *,
     qvi_rmi_msg_header *,
     void *,
@@ -733,8 +1957,9 @@ qvi_rmi_server::s_rpc_invalid(
     qvi_abort();
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_shutdown(
+qvi_rmi_server::s_rpc<QVI_RMI_FID_SERVER_SHUTDOWN>(
     qvi_rmi_server *,
     qvi_rmi_msg_header *hdr,
     void *,
@@ -744,197 +1969,362 @@ qvi_rmi_server::s_rpc_shutdown(
     return QV_SUCCESS_SHUTDOWN;
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_hello(
-    qvi_rmi_server *server,
-    qvi_rmi_msg_header *hdr,
-    void *input,
-    qvi_bbuff **output
+qvi_rmi_server::m_rpc<QVI_RMI_FID_HELLO>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_HELLO>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_HELLO>::results &results
 ) {
     const size_t server_version = QVI_0xVERSION;
-    int rpcrc = QV_SUCCESS;
-
-    size_t client_version;
-    qvi_hwloc_flags_t flags;
-    pid_t whoisit;
-    const int rc = qvi_bbuff::unpack(input, client_version, flags, whoisit);
-    if (qvi_unlikely(rc != QV_SUCCESS)) rpcrc = rc;
+    const auto &[client_version, flags, whoisit] = args;
+    auto &[hwtopo_path, hwtopo_shmem, generation_path] = results;
+    (void)whoisit;
     // Pack relevant configuration information.
+    auto &hwloc = m_hwlocs.get(flags);
+    hwtopo_path = hwloc.topology_file();
+    hwtopo_shmem = hwloc.topology_shmem();
+    generation_path = m_generation_path;
     // We are overly protective here for now. Insist the
     // client and server share the exact same release version.
     if (qvi_unlikely(server_version != client_version)) {
-        rpcrc = QV_ERR_NOT_SUPPORTED;
+        return QV_ERR_NOT_SUPPORTED;
     }
-    return rpc_pack(
-        output, hdr->fid, rpcrc,
-        server->m_hwlocs.get(flags).topology_file()
+    return QV_SUCCESS;
+}
+
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_GET_CPUBIND>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUBIND>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUBIND>::results &results
+) {
+    const auto &[flags, who] = args;
+    auto &[bitmap] = results;
+    return m_hwlocs.get(flags).task_get_cpubind(who, bitmap);
+}
+
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_SET_CPUBIND>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_SET_CPUBIND>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_SET_CPUBIND>::results &
+) {
+    const auto &[flags, who, cpuset] = args;
+    return m_hwlocs.get(flags).task_set_cpubind_from_cpuset(
+        who, cpuset.cdata()
     );
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_get_cpubind(
-    qvi_rmi_server *server,
-    qvi_rmi_msg_header *hdr,
-    void *input,
-    qvi_bbuff **output
+qvi_rmi_server::m_rpc<QVI_RMI_FID_SET_CPUBIND_MANY>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_SET_CPUBIND_MANY>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_SET_CPUBIND_MANY>::results &results
 ) {
-    int rpcrc = QV_SUCCESS;
-    qvi_hwloc_bitmap bitmap;
+    const auto &[flags, who, cpusets] = args;
+    auto &[rcs] = results;
+    if (qvi_unlikely(who.size() != cpusets.size())) return QV_ERR_INVLD_ARG;
 
-    do {
-        qvi_hwloc_flags_t flags;
-        pid_t who;
-        const int qvrc = qvi_bbuff::unpack(input, flags, who);
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            rpcrc = qvrc;
-            break;
+    auto &hwloc = m_hwlocs.get(flags);
+    int rpcrc = QV_SUCCESS;
+    rcs.resize(who.size());
+    for (size_t i = 0; i < who.size(); ++i) {
+        rcs[i] = hwloc.task_set_cpubind_from_cpuset(
+            who[i], cpusets[i].cdata()
+        );
+        if (qvi_unlikely(rcs[i] != QV_SUCCESS && rpcrc == QV_SUCCESS)) {
+            rpcrc = rcs[i];
         }
-        rpcrc = server->m_hwlocs.get(flags).task_get_cpubind(who, bitmap);
-    } while (false);
+    }
+    return rpcrc;
+}
 
-    return rpc_pack(output, hdr->fid, rpcrc, bitmap);
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_OBJ_TYPE_DEPTH>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_OBJ_TYPE_DEPTH>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_OBJ_TYPE_DEPTH>::results &results
+) {
+    const auto &[flags, obj] = args;
+    auto &[depth] = results;
+    return m_hwlocs.get(flags).obj_type_depth(obj, &depth);
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_set_cpubind(
-    qvi_rmi_server *server,
-    qvi_rmi_msg_header *hdr,
-    void *input,
-    qvi_bbuff **output
+qvi_rmi_server::m_rpc<QVI_RMI_FID_GET_NOBJS_IN_CPUSET>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_NOBJS_IN_CPUSET>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_GET_NOBJS_IN_CPUSET>::results &results
 ) {
-    int rpcrc = QV_SUCCESS;
+    const auto &[flags, target_obj, cpuset] = args;
+    auto &[nobjs] = results;
+    return m_hwlocs.get(flags).get_nobjs_in_cpuset(
+        target_obj, cpuset.cdata(), nobjs
+    );
+}
 
-    do {
-        qvi_hwloc_flags_t flags;
-        pid_t who;
-        qvi_hwloc_bitmap cpuset;
-        const int qvrc = qvi_bbuff::unpack(input, flags, who, cpuset);
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            rpcrc = qvrc;
-            break;
-        }
-        rpcrc = server->m_hwlocs.get(flags).task_set_cpubind_from_cpuset(
-            who, cpuset.cdata()
-        );
-    } while (false);
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS>::results &results
+) {
+    const auto &[flags, cpuset, obj_type, nobjs] = args;
+    auto &[result] = results;
+    return m_hwlocs.get(flags).get_cpuset_for_nobjs(
+        cpuset, obj_type, nobjs, result
+    );
+}
 
-    return rpc_pack(output, hdr->fid, rpcrc);
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_GET_DEVICE_IN_CPUSET>::results &results
+) {
+    const auto &[flags, dev_obj, dev_i, cpuset, devid_type] = args;
+    auto &[dev_id] = results;
+    return m_hwlocs.get(flags).get_device_id_in_cpuset(
+        dev_obj, dev_i, cpuset.cdata(), devid_type, dev_id
+    );
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_obj_type_depth(
-    qvi_rmi_server *server,
-    qvi_rmi_msg_header *hdr,
-    void *input,
-    qvi_bbuff **output
+qvi_rmi_server::m_rpc<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_GET_INTRINSIC_HWPOOL>::results &results
 ) {
-    int rpcrc = QV_SUCCESS;
-    int depth = 0;
+    const auto &[hwloc_flags, who, iscope, scope_flags] = args;
+    auto &[hwpool] = results;
+    (void)scope_flags;
+    // Bitmap that encodes available host resources.
+    qvi_hwloc_bitmap sbitmap;
 
-    do {
-        qvi_hwloc_flags_t flags;
-        qv_hw_obj_type_t obj;
-        const int qvrc = qvi_bbuff::unpack(input, flags, obj);
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            rpcrc = qvrc;
+    int rpcrc = QV_SUCCESS;
+    switch (iscope) {
+        case QV_SCOPE_SYSTEM:
+            rpcrc = QV_ERR_NOT_SUPPORTED;
             break;
-        }
-        rpcrc = server->m_hwlocs.get(flags).obj_type_depth(obj, &depth);
-    } while (false);
+        case QV_SCOPE_USER:
+            rpcrc = m_get_iscope_bitmap_user(hwloc_flags, sbitmap);
+            break;
+        case QV_SCOPE_JOB:
+            rpcrc = m_get_iscope_bitmap_job(hwloc_flags, who, sbitmap);
+            break;
+        case QV_SCOPE_PROCESS:
+            rpcrc = m_get_iscope_bitmap_proc(hwloc_flags, who, sbitmap);
+            break;
+        [[unlikely]] default:
+            rpcrc = QV_ERR_INVLD_ARG;
+            break;
+    }
+    if (qvi_unlikely(rpcrc != QV_SUCCESS)) return rpcrc;
+    return hwpool.populate(m_hwlocs.get(hwloc_flags), sbitmap);
+}
 
-    return rpc_pack(output, hdr->fid, rpcrc, depth);
+/**
+ * Returns the identifier under which a device is leased.
+ */
+static std::string
+lease_device_id(
+    const qvi_hwloc_device &dev
+) {
+    return dev.pci_bus_id.empty() ? dev.name : dev.pci_bus_id;
 }
 
-int
-qvi_rmi_server::s_rpc_get_nobjs_in_cpuset(
-    qvi_rmi_server *server,
-    qvi_rmi_msg_header *hdr,
-    void *input,
-    qvi_bbuff **output
+/**
+ * Returns when the provided process started, in clock ticks since boot, or 0
+ * if unknown.
+ */
+static uint64_t
+proc_start_time(
+    pid_t pid
 ) {
-    int rpcrc = QV_SUCCESS;
-    size_t nobjs = 0;
+    const std::string stat =
+        qvi_read_file("/proc/" + std::to_string(pid) + "/stat");
+    // The command name may contain anything, so skip past its end. The start
+    // time is the 20th field after it.
+    const size_t pos = stat.rfind(')');
+    if (pos == std::string::npos) return 0;
+    std::istringstream fields(stat.substr(pos + 1));
+    std::string field;
+    for (int i = 0; i < 20 && (fields >> field); ++i);
+    if (!fields) return 0;
+    return strtoull(field.c_str(), nullptr, 10);
+}
 
-    do {
-        qvi_hwloc_flags_t flags;
-        qv_hw_obj_type_t target_obj;
-        qvi_hwloc_bitmap cpuset;
-        const int qvrc = qvi_bbuff::unpack(
-            input, flags, target_obj, cpuset
-        );
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            rpcrc = qvrc;
-            break;
+void
+qvi_rmi_server::m_reap_leases(void)
+{
+    std::erase_if(m_leases, [](const auto &entry) {
+        const pid_t owner = entry.second.owner;
+        bool gone = kill(owner, 0) == -1 && errno == ESRCH;
+        // Or its PID now belongs to another process.
+        if (!gone && entry.second.owner_start != 0) {
+            gone = proc_start_time(owner) != entry.second.owner_start;
         }
-        rpcrc = server->m_hwlocs.get(flags).get_nobjs_in_cpuset(
-            target_obj, cpuset.cdata(), nobjs
-        );
-    } while (false);
-
-    return rpc_pack(output, hdr->fid, rpcrc, nobjs);
+        if (gone) {
+            qvi_log_debug(
+                "Releasing lease {} of exited process {}", entry.first, owner
+            );
+        }
+        return gone;
+    });
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_get_cpuset_for_nobjs(
-    qvi_rmi_server *server,
-    qvi_rmi_msg_header *hdr,
-    void *input,
-    qvi_bbuff **output
+qvi_rmi_server::m_rpc<QVI_RMI_FID_RESERVE>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_RESERVE>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_RESERVE>::results &results
 ) {
-    int rpcrc = QV_SUCCESS;
-    qvi_hwloc_bitmap result;
+    const auto &[flags, owner, cpuset, obj_type, nobjs] = args;
+    auto &[lease, hwpool] = results;
+    if (qvi_unlikely(nobjs <= 0)) return QV_ERR_INVLD_ARG;
+
+    const qvi_hwloc &hwloc = m_hwlocs.get(flags);
+
+    std::lock_guard<std::mutex> guard(m_leases_mutex);
+    m_reap_leases();
+    // Whatever other leases hold is off limits.
+    qvi_hwloc_bitmap avail(cpuset);
+    std::set<std::string> held_devices;
+    for (const auto &[id, held] : m_leases) {
+        hwloc_bitmap_andnot(avail.data(), avail.cdata(), held.cpuset.cdata());
+        held_devices.insert(held.devices.begin(), held.devices.end());
+    }
+    size_t navail = 0;
+    int rc = hwloc.get_nobjs_in_cpuset(obj_type, avail.cdata(), navail);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    if (navail < size_t(nobjs)) return QV_RES_UNAVAILABLE;
 
-    do {
-        qvi_hwloc_flags_t flags;
-        qvi_hwloc_bitmap cpuset;
-        qv_hw_obj_type_t obj_type;
-        int nobjs;
-        const int qvrc = qvi_bbuff::unpack(
-            input, flags, cpuset, obj_type, nobjs
-        );
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            rpcrc = qvrc;
-            break;
-        }
-        rpcrc = server->m_hwlocs.get(flags).get_cpuset_for_nobjs(
-            cpuset, obj_type, nobjs, result
+    qvi_hwloc_bitmap rcpuset;
+    rc = hwloc.get_cpuset_for_nobjs(avail, obj_type, nobjs, rcpuset);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    // Devices with affinity to the reserved PUs come along, unless leased.
+    qvi_rmi_lease nlease;
+    nlease.owner = owner;
+    nlease.owner_start = proc_start_time(owner);
+    nlease.cpuset = rcpuset;
+    hwpool = qvi_hwpool(rcpuset);
+    for (const auto devt : qvi_hwloc::supported_devices()) {
+        qvi_hwloc_dev_list devs;
+        rc = hwloc.get_devices_included_in_cpuset(
+            devt, rcpuset.cdata(), devs
         );
-    } while (false);
+        if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+        for (const auto &dev : devs) {
+            std::string devid = lease_device_id(*dev);
+            if (held_devices.contains(devid)) continue;
+            rc = hwpool.add_device(qvi_hwpool_dev(dev));
+            if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+            nlease.devices.push_back(std::move(devid));
+        }
+    }
+    lease = m_next_lease++;
+    m_leases.emplace(lease, std::move(nlease));
+    return QV_SUCCESS;
+}
+
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_RELEASE>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_RELEASE>::args &args,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_RELEASE>::results &
+) {
+    const auto &[owner, lease] = args;
+
+    std::lock_guard<std::mutex> guard(m_leases_mutex);
+    auto it = m_leases.find(lease);
+    if (qvi_unlikely(it == m_leases.end())) return QV_ERR_NOT_FOUND;
+    // Only the owner may release its lease.
+    if (qvi_unlikely(it->second.owner != owner)) return QV_ERR_INVLD_ARG;
+    m_leases.erase(it);
+    return QV_SUCCESS;
+}
 
-    return rpc_pack(output, hdr->fid, rpcrc, result);
+template <>
+int
+qvi_rmi_server::m_rpc<QVI_RMI_FID_STATS>(
+    const qvi_rmi_rpc_schema<QVI_RMI_FID_STATS>::args &,
+    qvi_rmi_rpc_schema<QVI_RMI_FID_STATS>::results &results
+) {
+    auto &[stats] = results;
+    stats = m_stats_snapshot();
+    return QV_SUCCESS;
 }
 
+template <>
 int
-qvi_rmi_server::s_rpc_get_device_in_cpuset(
+qvi_rmi_server::s_rpc<QVI_RMI_FID_BATCH>(
     qvi_rmi_server *server,
     qvi_rmi_msg_header *hdr,
     void *input,
     qvi_bbuff **output
 ) {
+    int rc = QV_SUCCESS;
     int rpcrc = QV_SUCCESS;
-    std::string dev_id;
+    qvi_bbuff replies;
 
     do {
-        qvi_hwloc_flags_t flags;
-        qv_hw_obj_type_t dev_obj;
-        int dev_i;
-        qvi_hwloc_bitmap cpuset;
-        qv_device_id_type_t devid_type;
-        const int qvrc = qvi_bbuff::unpack(
-            input, flags, dev_obj, dev_i, cpuset, devid_type
-        );
-        if (qvi_unlikely(qvrc != QV_SUCCESS)) {
-            rpcrc = qvrc;
-            break;
+        size_t nops = 0;
+        rpcrc = qvi_bbuff::unpack(input, nops);
+        if (qvi_unlikely(rpcrc != QV_SUCCESS)) break;
+        // The requests follow the batch's packed body.
+        byte_t *data = (byte_t *)input + packed_size(input);
+
+        for (size_t i = 0; i < nops; ++i) {
+            qvi_rmi_msg_header ophdr;
+            const size_t trim = unpack_msg_header(data, &ophdr);
+            // Only queries and updates can be batched.
+            if (qvi_unlikely(
+                ophdr.fid >= QVI_RMI_FID_LAST ||
+                ophdr.fid == QVI_RMI_FID_INVALID ||
+                ophdr.fid == QVI_RMI_FID_SERVER_SHUTDOWN ||
+                ophdr.fid == QVI_RMI_FID_HELLO ||
+                ophdr.fid == QVI_RMI_FID_BATCH
+            )) {
+                qvi_log_error("Function ID ({}) cannot be batched.", ophdr.fid);
+                rpcrc = QV_ERR_RPC;
+                break;
+            }
+
+            // Batched requests come from the batch's sender, whatever they say.
+            ophdr.peer = hdr->peer;
+            const uint64_t start_ns = steady_ns();
+            qvi_bbuff *result = nullptr;
+            rc = s_rpc_dispatch_table[ophdr.fid](
+                server, &ophdr, data_trim(data, trim), &result
+            );
+            if (qvi_likely(rc == QV_SUCCESS)) {
+                // Batched requests do not wait in the queue on their own.
+                server->m_stats[ophdr.fid].record(
+                    rpc_msg_size(data), result->size(),
+                    0, steady_ns() - start_ns
+                );
+                rc = replies.append(result->cdata(), result->size());
+            }
+            qvi_delete(&result);
+            if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+            data += rpc_msg_size(data);
         }
-        rpcrc = server->m_hwlocs.get(flags).get_device_id_in_cpuset(
-            dev_obj, dev_i, cpuset.cdata(), devid_type, dev_id
-        );
     } while (false);
+    // Replies are only meaningful if every request was serviced.
+    rc = rpc_pack(output, hdr->fid, rpcrc);
+    if (qvi_unlikely(rc != QV_SUCCESS || rpcrc != QV_SUCCESS)) return rc;
 
-    return rpc_pack(output, hdr->fid, rpcrc, dev_id);
+    rc = (*output)->append(replies.cdata(), replies.size());
+    if (qvi_unlikely(rc != QV_SUCCESS)) qvi_delete(output);
+    return rc;
 }
 
+const std::array<qvi_rmi_rpc_fun_ptr_t, QVI_RMI_FID_LAST>
+qvi_rmi_server::s_rpc_dispatch_table = s_make_rpc_dispatch_table(
+    std::make_index_sequence<QVI_RMI_FID_LAST>()
+);
+
 int
 qvi_rmi_server::m_rpc_dispatch(
     void *zsock,
@@ -951,8 +2341,7 @@ qvi_rmi_server::m_rpc_dispatch(
         const size_t trim = unpack_msg_header(data, &hdr);
         void *const body = data_trim(data, trim);
 
-        const auto fidfunp = m_rpc_dispatch_table.find(hdr.fid);
-        if (qvi_unlikely(fidfunp == m_rpc_dispatch_table.end())) {
+        if (qvi_unlikely(hdr.fid >= QVI_RMI_FID_LAST)) {
             qvi_log_error(
                 "Unknown function ID ({}) in RPC. Aborting.", hdr.fid
             );
@@ -960,8 +2349,12 @@ qvi_rmi_server::m_rpc_dispatch(
             break;
         }
 
+        const uint64_t start_ns = steady_ns();
         qvi_bbuff *result = nullptr;
-        rc = fidfunp->second(this, &hdr, body, &result);
+        // The topologies must not change until the reply is stamped with
+        // their generation.
+        std::shared_lock<std::shared_mutex> hwlocs_lock(m_hwlocs_mutex);
+        rc = s_rpc_dispatch_table[hdr.fid](this, &hdr, body, &result);
         if (qvi_unlikely(rc != QV_SUCCESS && rc != QV_SUCCESS_SHUTDOWN)) {
             cstr_t ers = "RPC dispatch failed";
             qvi_log_error("{} with rc={} ({})", ers, rc, qv_strerr(rc));
@@ -971,6 +2364,17 @@ qvi_rmi_server::m_rpc_dispatch(
         if (qvi_unlikely(rc == QV_SUCCESS_SHUTDOWN)) {
             shutdown = true;
         }
+        // Requests stamped by the main loop also account for queueing.
+        const uint64_t end_ns = steady_ns();
+        m_stats[hdr.fid].record(
+            zmq_msg_size(command_msg), result->size(),
+            hdr.rx_ns ? start_ns - std::min(hdr.rx_ns, start_ns) : 0,
+            end_ns - start_ns
+        );
+        // Let the client match the reply to its request.
+        buffer_set_rid(result, hdr.rid);
+        buffer_set_gen(result, m_generation.load(std::memory_order_relaxed));
+        hwlocs_lock.unlock();
         rc = zsock_send_bbuff(zsock, result, bsent);
     } while (false);
 
@@ -978,22 +2382,460 @@ qvi_rmi_server::m_rpc_dispatch(
     return (shutdown ? QV_SUCCESS_SHUTDOWN : rc);
 }
 
+/**
+ * Returns whether the RPC identified by the provided function ID acts on
+ * behalf of the process that sent it.
+ */
+static inline bool
+rpc_needs_peer(
+    qvi_rmi_rpc_fid_t fid
+) {
+    return fid == QVI_RMI_FID_RESERVE ||
+           fid == QVI_RMI_FID_RELEASE ||
+           fid == QVI_RMI_FID_BATCH;
+}
+
+/**
+ * Returns the process that sent the provided message as determined from its
+ * connection, or 0 if the transport cannot tell, as is the case with TCP.
+ */
+static pid_t
+zmsg_peer(
+    zmq_msg_t *msg
+) {
+    const int fd = zmq_msg_get(msg, ZMQ_SRCFD);
+    if (fd == -1) return 0;
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) return 0;
+    return cred.pid;
+}
+
 int
-qvi_rmi_server::m_enter_main_server_loop(void)
+qvi_rmi_server::s_forward_msg(
+    void *from,
+    void *to,
+    bool stamp
+) {
+    int more = 0;
+    do {
+        zmq_msg_t msg;
+        int zrc = zmq_msg_init(&msg);
+        if (qvi_unlikely(zrc != 0)) {
+            const int eno = errno;
+            zerr_msg("zmq_msg_init() failed", eno);
+            return QV_ERR_RPC;
+        }
+        zrc = zmq_msg_recv(&msg, from, 0);
+        if (qvi_unlikely(zrc == -1)) {
+            const int eno = errno;
+            zerr_msg("zmq_msg_recv() failed", eno);
+            zmq_msg_close(&msg);
+            return QV_ERR_RPC;
+        }
+        more = zmq_msg_more(&msg);
+        // The request body is the last frame, after the routing envelope.
+        const size_t hdrsize = sizeof(qvi_rmi_msg_header);
+        if (stamp && !more && zmq_msg_size(&msg) >= hdrsize) {
+            byte_t *data = (byte_t *)zmq_msg_data(&msg);
+            const uint64_t rx_ns = steady_ns();
+            memcpy(
+                data + offsetof(qvi_rmi_msg_header, rx_ns),
+                &rx_ns, sizeof(rx_ns)
+            );
+            qvi_rmi_rpc_fid_t fid = QVI_RMI_FID_INVALID;
+            memcpy(&fid, data + offsetof(qvi_rmi_msg_header, fid), sizeof(fid));
+            // Whatever the client put there cannot be trusted.
+            const pid_t peer = rpc_needs_peer(fid) ? zmsg_peer(&msg) : 0;
+            memcpy(
+                data + offsetof(qvi_rmi_msg_header, peer), &peer, sizeof(peer)
+            );
+        }
+        // On success, zmq_msg_send() takes ownership of the message.
+        zrc = zmq_msg_send(&msg, to, more ? ZMQ_SNDMORE : 0);
+        if (qvi_unlikely(zrc == -1)) {
+            const int eno = errno;
+            zerr_msg("zmq_msg_send() failed", eno);
+            zmq_msg_close(&msg);
+            return QV_ERR_RPC;
+        }
+    } while (more);
+    return QV_SUCCESS;
+}
+
+void
+qvi_rmi_server::m_worker_loop(void)
 {
-    int rc, bsent;
-    int bsentt = 0;
-    zmq_msg_t mrx;
+    int rc = QV_SUCCESS;
+    // Each worker owns its sockets: ZMQ sockets are not thread-safe.
+    void *zsock = zsocket_create(m_zctx, ZMQ_REP);
+    void *zcontrol = zsocket_create(m_zctx, ZMQ_PUSH);
     do {
-        rc = m_recv_msg(&mrx);
+        if (qvi_unlikely(!zsock || !zcontrol)) {
+            rc = QV_ERR_RPC;
+            break;
+        }
+        rc = zsocket_set_linger(zsock, 0);
         if (qvi_unlikely(rc != QV_SUCCESS)) break;
-        rc = m_rpc_dispatch(m_zsock, &mrx, &bsent);
-        if (qvi_likely(rc == QV_SUCCESS)) bsentt += bsent;
-        else break;
+        rc = zsocket_set_linger(zcontrol, 0);
+        if (qvi_unlikely(rc != QV_SUCCESS)) break;
+        // Note that zsocket_connect() closes the socket on failure.
+        rc = zsocket_connect(zcontrol, s_control_url);
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            zcontrol = nullptr;
+            break;
+        }
+        rc = zsocket_connect(zsock, s_workers_url);
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            zsock = nullptr;
+            break;
+        }
+        do {
+            zmq_msg_t mrx;
+            int zrc = zmq_msg_init(&mrx);
+            if (qvi_unlikely(zrc != 0)) {
+                const int eno = errno;
+                zerr_msg("zmq_msg_init() failed", eno);
+                rc = QV_ERR_RPC;
+                break;
+            }
+            // Block until a request is routed to us.
+            zrc = zmq_msg_recv(&mrx, zsock, 0);
+            if (qvi_unlikely(zrc == -1)) {
+                const int eno = errno;
+                zmq_msg_close(&mrx);
+                // The context was shut down, so we are done.
+                if (eno == ETERM) break;
+                if (eno == EINTR) continue;
+                zerr_msg("zmq_msg_recv() failed", eno);
+                rc = QV_ERR_RPC;
+                break;
+            }
+            int bsent = 0;
+            rc = m_rpc_dispatch(zsock, &mrx, &bsent);
+            if (qvi_likely(rc == QV_SUCCESS)) m_bytes_sent += bsent;
+            else break;
+        } while (true);
+    } while (false);
+    // Let the main loop know why we stopped, unless we were told to.
+    if (qvi_likely(zcontrol) && rc != QV_SUCCESS) {
+        (void)zmq_send(zcontrol, &rc, sizeof(rc), 0);
+    }
+    zsocket_close(zcontrol);
+    zsocket_close(zsock);
+}
+
+int
+qvi_rmi_server::m_start_workers(void)
+{
+    // The back end and control endpoints must be bound before workers connect.
+    m_zworkers = zsocket_create_and_bind(m_zctx, ZMQ_DEALER, s_workers_url);
+    if (qvi_unlikely(!m_zworkers)) return QV_ERR_SYS;
+
+    int rc = zsocket_set_linger(m_zworkers, 0);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+    m_zcontrol = zsocket_create_and_bind(m_zctx, ZMQ_PULL, s_control_url);
+    if (qvi_unlikely(!m_zcontrol)) return QV_ERR_SYS;
+
+    rc = zsocket_set_linger(m_zcontrol, 0);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+    const size_t nworkers = std::max(m_config.nworkers, size_t(1));
+    try {
+        for (size_t i = 0; i < nworkers; ++i) {
+            m_workers.emplace_back(&qvi_rmi_server::m_worker_loop, this);
+        }
+    }
+    catch (const std::system_error &e) {
+        qvi_log_error("Failed to start worker thread: {}", e.what());
+        return QV_ERR_SYS;
+    }
+    return QV_SUCCESS;
+}
+
+void
+qvi_rmi_server::m_stop_workers(void)
+{
+    if (m_workers.empty()) return;
+    // Unblocks workers waiting in zmq_msg_recv() with ETERM. Our
+    // own sockets remain usable until they are closed in the destructor.
+    const int zrc = zmq_ctx_shutdown(m_zctx);
+    if (qvi_unlikely(zrc != 0)) {
+        const int eno = errno;
+        zwrn_msg("zmq_ctx_shutdown() failed", eno);
+    }
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+int
+qvi_rmi_server::m_recv_signals(void)
+{
+    int rc = QV_SUCCESS;
+    // Several signals may be pending.
+    do {
+        struct signalfd_siginfo info;
+        const ssize_t nread = read(m_sigfd, &info, sizeof(info));
+        if (nread == -1) {
+            const int eno = errno;
+            if (eno == EAGAIN) break;
+            if (eno == EINTR) continue;
+            qvi_log_error(
+                "read() of signalfd failed with errno={} ({})",
+                eno, strerror(eno)
+            );
+            return QV_ERR_SYS;
+        }
+        if (qvi_unlikely(nread != sizeof(info))) return QV_ERR_SYS;
+
+        if (info.ssi_signo == SIGUSR1) {
+            // Failing to dump statistics is not fatal.
+            (void)m_dump_stats();
+        }
+        else {
+            qvi_log_info("Received {}", strsignal(info.ssi_signo));
+            rc = QV_SUCCESS_SHUTDOWN;
+        }
+    } while (true);
+    return rc;
+}
+
+/**
+ * Interval in milliseconds at which the server checks the files listing the
+ * PUs we may use. sysfs and cgroupfs do not notify of all changes to them.
+ */
+static constexpr long s_hwwatch_interval_ms = 5000;
+
+/**
+ * Returns the paths of the files listing the PUs we may use, under the
+ * provided root directory.
+ */
+static std::vector<std::string>
+hwwatch_paths(
+    const std::string &root
+) {
+    std::vector<std::string> paths = {
+        root + "/sys/devices/system/cpu/online"
+    };
+    // Those of cgroup v2 and v1: either may be in use.
+    for (const auto &path : qvi_hwloc::cgroup_cpuset_files(root)) {
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+int
+qvi_rmi_server::m_hwwatch_start(void)
+{
+    m_hwwatch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (qvi_unlikely(m_hwwatch_fd == -1)) {
+        const int eno = errno;
+        qvi_log_error(
+            "inotify_init1() failed with errno={} ({})", eno, strerror(eno)
+        );
+        return QV_ERR_SYS;
+    }
+    // Watch their directories, since files may also be replaced.
+    const uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO |
+                          IN_CREATE | IN_DELETE;
+    for (const auto &path : hwwatch_paths(m_config.sysfs_root)) {
+        const std::string dir = std::filesystem::path(path).parent_path();
+        if (inotify_add_watch(m_hwwatch_fd, dir.c_str(), mask) == -1) {
+            const int eno = errno;
+            qvi_log_debug("Cannot watch {} ({})", dir, strerror(eno));
+            continue;
+        }
+        m_hwwatch_paths.push_back(path);
+        m_hwwatch_state.push_back(qvi_read_file(path));
+    }
+    if (m_hwwatch_paths.empty()) {
+        (void)close(m_hwwatch_fd);
+        m_hwwatch_fd = -1;
+        return QV_ERR_NOT_FOUND;
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_rmi_server::m_hwwatch_check(void)
+{
+    // Drain pending events: which file changed doesn't matter.
+    alignas(struct inotify_event) char events[4096];
+    while (read(m_hwwatch_fd, events, sizeof(events)) > 0);
+
+    std::vector<std::string> state;
+    for (const auto &path : m_hwwatch_paths) {
+        state.push_back(qvi_read_file(path));
+    }
+    if (qvi_likely(state == m_hwwatch_state)) return QV_SUCCESS;
+    m_hwwatch_state = state;
+    // Only the main loop updates the topologies, so no need to lock here.
+    auto &full = m_hwlocs.get(QVI_HWLOC_FLAG_TOPO_FULL);
+    qvi_hwloc_bitmap allowed(full.topology_get_disallowed_cpuset());
+    for (std::string contents : state) {
+        // hwloc misreads single PUs followed by a newline.
+        while (!contents.empty() && isspace(contents.back())) {
+            contents.pop_back();
+        }
+        // The file may be missing, or hold a list we cannot parse.
+        qvi_hwloc_bitmap cpuset;
+        if (contents.empty()) continue;
+        if (hwloc_bitmap_list_sscanf(cpuset.data(), contents.c_str()) != 0) {
+            continue;
+        }
+        hwloc_bitmap_and(allowed.data(), allowed.cdata(), cpuset.cdata());
+    }
+    if (allowed == qvi_hwloc_bitmap(full.topology_get_cpuset())) {
+        return QV_SUCCESS;
+    }
+    return m_topology_allow(allowed);
+}
+
+int
+qvi_rmi_server::m_topology_allow(
+    const qvi_hwloc_bitmap &cpuset
+) {
+    int rc = QV_SUCCESS;
+    // Wait for the workers to be done with the current topologies.
+    std::unique_lock<std::shared_mutex> hwlocs_lock(m_hwlocs_mutex);
+    for (const auto topo_type : qvi_hwloc::topo_types()) {
+        const int arc = m_hwlocs.get(topo_type).topology_allow(cpuset);
+        if (qvi_unlikely(arc != QV_SUCCESS)) {
+            qvi_log_warn(
+                "Cannot allow PUs {} in topology {}",
+                qvi_hwloc::bitmap_string(cpuset), topo_type
+            );
+            rc = arc;
+        }
+    }
+    // Replies computed from the previous topologies no longer hold.
+    {
+        std::lock_guard<std::mutex> guard(m_replies_mutex);
+        m_replies.clear();
+    }
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+    // Clients that connect from now on must load the current topologies.
+    if (!m_topo_export_path.empty()) {
+        const int erc = topology_export(m_topo_export_path);
+        if (qvi_unlikely(erc != QV_SUCCESS)) {
+            qvi_log_warn("Cannot export the topologies (rc={})", erc);
+            rc = erc;
+        }
+    }
+    // Only now may clients go looking for the new topologies.
+    if (m_generation_word) {
+        m_generation_word->store(
+            m_generation.load(std::memory_order_relaxed),
+            std::memory_order_release
+        );
+    }
+    qvi_log_info(
+        "Allowed PUs changed to {}", qvi_hwloc::bitmap_string(cpuset)
+    );
+    return rc;
+}
+
+int
+qvi_rmi_server::m_enter_main_server_loop(void)
+{
+    int rc = QV_SUCCESS;
+
+    const int npoll_items = 5;
+    zmq_pollitem_t poll_items[npoll_items] = {
+        // Requests from clients.
+        {m_zsock, 0, ZMQ_POLLIN, 0},
+        // Replies from workers.
+        {m_zworkers, 0, ZMQ_POLLIN, 0},
+        // Worker exit notifications.
+        {m_zcontrol, 0, ZMQ_POLLIN, 0},
+        // Signals.
+        {nullptr, m_sigfd, ZMQ_POLLIN, 0},
+        // Changes to the PUs we may use, if watched.
+        {nullptr, m_hwwatch_fd, ZMQ_POLLIN, 0}
+    };
+    const int npoll = (m_hwwatch_fd != -1) ? npoll_items : npoll_items - 1;
+    const uint64_t hwwatch_interval_ns = s_hwwatch_interval_ms * 1000000;
+    uint64_t hwwatch_ns = steady_ns();
+
+    do {
+        // Besides watched files, every event we care about wakes us up. The
+        // others must be checked periodically, however busy we are.
+        long timeout = -1;
+        if (m_hwwatch_fd != -1) {
+            const uint64_t elapsed_ns = steady_ns() - hwwatch_ns;
+            timeout = (elapsed_ns >= hwwatch_interval_ns) ? 0 :
+                (hwwatch_interval_ns - elapsed_ns + 999999) / 1000000;
+        }
+        const int zrc = zmq_poll(poll_items, npoll, timeout);
+        if (qvi_unlikely(zrc == -1)) {
+            const int eno = errno;
+            // Interrupted by a signal that is not ours, so try again.
+            if (eno == EINTR) {
+                continue;
+            }
+            // A real error occurred.
+            else {
+                zerr_msg("zmq_poll() failed", eno);
+                rc = QV_ERR_RPC;
+                break;
+            }
+        }
+        // Forward replies first so that a reply sent before
+        // a worker's exit notification is not dropped.
+        if (poll_items[1].revents & ZMQ_POLLIN) {
+            rc = s_forward_msg(m_zworkers, m_zsock);
+            if (qvi_unlikely(rc != QV_SUCCESS)) break;
+        }
+        if (poll_items[0].revents & ZMQ_POLLIN) {
+            rc = s_forward_msg(m_zsock, m_zworkers, true);
+            if (qvi_unlikely(rc != QV_SUCCESS)) break;
+        }
+        if (poll_items[2].revents & ZMQ_POLLIN) {
+            int wrc = QV_ERR_RPC;
+            if (zmq_recv(m_zcontrol, &wrc, sizeof(wrc), 0) == -1) {
+                const int eno = errno;
+                zerr_msg("zmq_recv() failed", eno);
+            }
+            // Drain any replies that are still in flight.
+            while (zmq_poll(&poll_items[1], 1, 0) == 1) {
+                if (s_forward_msg(m_zworkers, m_zsock) != QV_SUCCESS) break;
+            }
+            rc = wrc;
+            break;
+        }
+        if (poll_items[3].revents & ZMQ_POLLIN) {
+            rc = m_recv_signals();
+            if (rc != QV_SUCCESS) break;
+        }
+        if (m_hwwatch_fd != -1) {
+            const bool due = steady_ns() - hwwatch_ns >= hwwatch_interval_ns;
+            if (due || poll_items[4].revents) {
+                // Not fatal: clients keep getting the previous view.
+                (void)m_hwwatch_check();
+                hwwatch_ns = steady_ns();
+            }
+        }
     } while(true);
 
+    m_stop_workers();
     // Nice to understand messaging characteristics.
-    qvi_log_info("Server Sent {} bytes", bsentt);
+    qvi_log_info("Server Sent {} bytes", m_bytes_sent.load());
+    qvi_log_info("Server Reused {} replies", m_replies_reused.load());
+    const auto stats = m_stats_snapshot();
+    for (size_t fid = 0; fid < stats.size(); ++fid) {
+        const auto &fstats = stats[fid];
+        if (fstats.count == 0) continue;
+        qvi_log_info(
+            "--{}: {} requests, {} bytes in, {} bytes out, "
+            "{} us queued, {} us serviced",
+            qvi_rmi_rpc_fid_name(qvi_rmi_rpc_fid_t(fid)), fstats.count,
+            fstats.bytes_in, fstats.bytes_out,
+            fstats.queue_ns / 1000, fstats.handler_ns / 1000
+        );
+    }
 
     if (qvi_unlikely(rc != QV_SUCCESS && rc != QV_SUCCESS_SHUTDOWN)) {
         qvi_log_error("RX/TX loop exited with rc={} ({})", rc, qv_strerr(rc));
@@ -1002,6 +2844,60 @@ qvi_rmi_server::m_enter_main_server_loop(void)
     return QV_SUCCESS;
 }
 
+std::vector<qvi_rmi_rpc_stats>
+qvi_rmi_server::m_stats_snapshot(void) const
+{
+    std::vector<qvi_rmi_rpc_stats> result;
+    result.reserve(m_stats.size());
+    for (const auto &counters : m_stats) {
+        result.push_back(counters.snapshot());
+    }
+    return result;
+}
+
+int
+qvi_rmi_server::m_dump_stats(void) const
+{
+    const std::string path = qvi_session_dir(m_config.portno) + "/rmi-stats";
+    // Write to a temporary file first so readers never see a partial dump.
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::trunc);
+    if (qvi_unlikely(!out)) {
+        qvi_log_warn("Cannot open {} for writing", tmp_path);
+        return QV_ERR_FILE_IO;
+    }
+    // Histogram buckets are in log2 microseconds, see qvi_rmi_rpc_stats.
+    out << "# fid count bytes_in bytes_out queue_ns handler_ns"
+        << " queue_hist[" << qvi_rmi_rpc_stats::nbuckets << "]"
+        << " handler_hist[" << qvi_rmi_rpc_stats::nbuckets << "]\n";
+    const auto stats = m_stats_snapshot();
+    for (size_t fid = 0; fid < stats.size(); ++fid) {
+        const auto &fstats = stats[fid];
+        out << qvi_rmi_rpc_fid_name(qvi_rmi_rpc_fid_t(fid))
+            << " " << fstats.count
+            << " " << fstats.bytes_in << " " << fstats.bytes_out
+            << " " << fstats.queue_ns << " " << fstats.handler_ns;
+        for (const auto count : fstats.queue_hist) out << " " << count;
+        for (const auto count : fstats.handler_hist) out << " " << count;
+        out << "\n";
+    }
+    out.close();
+    if (qvi_unlikely(!out)) {
+        qvi_log_warn("Failed to write {}", tmp_path);
+        return QV_ERR_FILE_IO;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (qvi_unlikely(ec)) {
+        qvi_log_warn(
+            "Cannot rename {} to {}: {}", tmp_path, path, ec.message()
+        );
+        return QV_ERR_FILE_IO;
+    }
+    qvi_log_info("Wrote RPC statistics to {}", path);
+    return QV_SUCCESS;
+}
+
 int
 qvi_rmi_server::configure(
     const qvi_rmi_config &config
@@ -1014,36 +2910,129 @@ int
 qvi_rmi_server::topology_export(
     const std::string &base_path
 ) {
+    // Topologies published in shared memory must be adopted by clients at the
+    // addresses used here. Place them back-to-back far from the regions where
+    // the kernel usually places mappings. If the range isn't available in a
+    // client, it falls back to loading the topology from XML.
+    m_topo_export_path = base_path;
+    uint64_t shmem_addr = s_shmem_base_addr;
     for (const auto topo_type : qvi_hwloc::topo_types()) {
         auto &hwloc = m_hwlocs.get(topo_type);
         const int rc = hwloc.topology_export(base_path);
         if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+
+        const int src = hwloc.topology_export_shmem(base_path, shmem_addr);
+        if (qvi_unlikely(src != QV_SUCCESS)) {
+            qvi_log_warn("Shared-memory topology publication unavailable");
+            continue;
+        }
+        shmem_addr += hwloc.topology_shmem().length;
+    }
+    if (!m_generation_word) {
+        const int rc = m_generation_publish(base_path);
+        // Clients then learn of new generations with their next request.
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            qvi_log_warn("Generation publication unavailable");
+        }
+    }
+    return QV_SUCCESS;
+}
+
+int
+qvi_rmi_server::m_generation_publish(
+    const std::string &base_path
+) {
+    static_assert(
+        std::atomic<uint64_t>::is_always_lock_free,
+        "The generation word must be usable across processes"
+    );
+    const std::string path =
+        base_path + "/generation." + std::to_string(getpid());
+    const int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (qvi_unlikely(fd == -1)) {
+        const int eno = errno;
+        qvi_log_error("open() failed with errno={} ({})", eno, strerror(eno));
+        return QV_ERR_FILE_IO;
+    }
+    const size_t length = sysconf(_SC_PAGESIZE);
+    void *addr = MAP_FAILED;
+    // Readable by clients regardless of the current umask.
+    int rc = fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (qvi_likely(rc == 0)) rc = ftruncate(fd, length);
+    if (qvi_likely(rc == 0)) {
+        addr = mmap(
+            nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0
+        );
+    }
+    const int eno = errno;
+    (void)close(fd);
+    if (qvi_unlikely(addr == MAP_FAILED)) {
+        qvi_log_error(
+            "Cannot map {} (errno={}, {})", path, eno, strerror(eno)
+        );
+        (void)unlink(path.c_str());
+        return QV_ERR_FILE_IO;
     }
+    m_generation_word = new (addr) std::atomic<uint64_t>(
+        m_generation.load(std::memory_order_relaxed)
+    );
+    m_generation_path = path;
     return QV_SUCCESS;
 }
 
 int
 qvi_rmi_server::start(void)
 {
-    // Setup our connection.
+    // Don't hijack the endpoint of a server that is already running.
+    if (qvi_unlikely(zendpoint_in_use(m_config.url))) {
+        qvi_log_error("A server is already listening on {}", m_config.url);
+        return QV_ERR_SYS;
+    }
+    // Setup our connection. Clients talk to a ROUTER that
+    // load-balances their requests across our workers.
     m_zsock = zsocket_create_and_bind(
-        m_zctx, ZMQ_REP, m_config.url.c_str()
+        m_zctx, ZMQ_ROUTER, m_config.url.c_str()
     );
     if (qvi_unlikely(!m_zsock)) return QV_ERR_SYS;
     // Set linger period to 0 so clients won't hang when a server shutdown
     // request is handled. A value of 0 means the following: pending messages
     // shall be discarded immediately when the socket is closed.
-    const int linger = 0;
-    const int zrc = zmq_setsockopt(
-        m_zsock, ZMQ_LINGER, &linger, sizeof(linger)
-    );
-    if (qvi_unlikely(zrc != 0)) {
+    const int rc = zsocket_set_linger(m_zsock, 0);
+    if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
+    // Receive our signals in the main loop.
+    const sigset_t sigs = server_signals();
+    m_sigfd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (qvi_unlikely(m_sigfd == -1)) {
         const int eno = errno;
-        zerr_msg("zmq_setsockopt(ZMQ_LINGER) failed", eno);
+        qvi_log_error(
+            "signalfd() failed with errno={} ({})", eno, strerror(eno)
+        );
         return QV_ERR_SYS;
     }
+    // Follow changes to the PUs we may use. Without them, we keep the view
+    // discovered at startup, so this isn't fatal.
+    const int hrc = m_hwwatch_start();
+    if (qvi_unlikely(hrc != QV_SUCCESS)) {
+        qvi_log_warn("Changes to the allowed PUs will not be followed");
+    }
+    // Start the workers.
+    const int wrc = m_start_workers();
+    if (qvi_unlikely(wrc != QV_SUCCESS)) return wrc;
+    // Now that the endpoint is ours, let clients find us without scanning
+    // /proc. They still can, so this isn't fatal.
+    const int prc = qvi_session_publish(m_config.portno);
+    if (qvi_unlikely(prc != QV_SUCCESS)) {
+        qvi_log_warn(
+            "Cannot publish session record {} (rc={}, {})",
+            qvi_session_record_path(m_config.portno), prc, qv_strerr(prc)
+        );
+    }
+    // Tell whoever is waiting for us that we accept connections.
+    notify_ready(m_config.ready_fd);
     // Start the main service loop.
-    return m_enter_main_server_loop();
+    const int lrc = m_enter_main_server_loop();
+    if (prc == QV_SUCCESS) (void)qvi_session_unpublish(m_config.portno);
+    return lrc;
 }
 
 int
@@ -1051,17 +3040,64 @@ qvi_rmi_get_url(
     std::string &url,
     int &portno
 ) {
-    static const std::string base = "tcp://127.0.0.1";
+    static const std::string tcp_base = "tcp://127.0.0.1";
 
     if (portno == QVI_PORT_UNSET) {
         portno = qvi_port_from_env();
         if (portno == QVI_PORT_UNSET) return QV_ERR_ENV;
     }
-
-    url = base + ":" + std::to_string(portno);
+    // Prefer a Unix-domain socket in the session directory. Only fall back
+    // to loopback TCP when the resulting path cannot be used as an address.
+    const std::string ipc_path = qvi_session_ipc_path(portno);
+    if (qvi_likely(!ipc_path.empty())) {
+        url = "ipc://" + ipc_path;
+    }
+    else {
+        url = tcp_base + ":" + std::to_string(portno);
+    }
     return QV_SUCCESS;
 }
 
+cstr_t
+qvi_rmi_rpc_fid_name(
+    qvi_rmi_rpc_fid_t fid
+) {
+    switch (fid) {
+        case QVI_RMI_FID_INVALID:
+            return "INVALID";
+        case QVI_RMI_FID_SERVER_SHUTDOWN:
+            return "SERVER_SHUTDOWN";
+        case QVI_RMI_FID_HELLO:
+            return "HELLO";
+        case QVI_RMI_FID_GET_CPUBIND:
+            return "GET_CPUBIND";
+        case QVI_RMI_FID_SET_CPUBIND:
+            return "SET_CPUBIND";
+        case QVI_RMI_FID_SET_CPUBIND_MANY:
+            return "SET_CPUBIND_MANY";
+        case QVI_RMI_FID_OBJ_TYPE_DEPTH:
+            return "OBJ_TYPE_DEPTH";
+        case QVI_RMI_FID_GET_NOBJS_IN_CPUSET:
+            return "GET_NOBJS_IN_CPUSET";
+        case QVI_RMI_FID_GET_CPUSET_FOR_NOBJS:
+            return "GET_CPUSET_FOR_NOBJS";
+        case QVI_RMI_FID_GET_DEVICE_IN_CPUSET:
+            return "GET_DEVICE_IN_CPUSET";
+        case QVI_RMI_FID_GET_INTRINSIC_HWPOOL:
+            return "GET_INTRINSIC_HWPOOL";
+        case QVI_RMI_FID_RESERVE:
+            return "RESERVE";
+        case QVI_RMI_FID_RELEASE:
+            return "RELEASE";
+        case QVI_RMI_FID_STATS:
+            return "STATS";
+        case QVI_RMI_FID_BATCH:
+            return "BATCH";
+        default:
+            return "UNKNOWN";
+    }
+}
+
 std::string
 qvi_rmi_conn_env_ers(void)
 {
@@ -20,11 +20,14 @@
 #define QVI_RMI_H
 
 #include "qvi-common.h"
+#include "qvi-bbuff.h"
 #include "qvi-hwpool.h"
+#include "qvi-utils.h"
 #include "zmq.h"
 
 struct qvi_rmi_msg_header;
 struct qvi_rmi_server;
+struct qvi_rmi_client;
 
 enum qvi_rmi_rpc_fid_t {
     QVI_RMI_FID_INVALID = 0,
@@ -32,11 +35,179 @@ enum qvi_rmi_rpc_fid_t {
     QVI_RMI_FID_HELLO,
     QVI_RMI_FID_GET_CPUBIND,
     QVI_RMI_FID_SET_CPUBIND,
+    QVI_RMI_FID_SET_CPUBIND_MANY,
     QVI_RMI_FID_OBJ_TYPE_DEPTH,
     QVI_RMI_FID_GET_NOBJS_IN_CPUSET,
     QVI_RMI_FID_GET_CPUSET_FOR_NOBJS,
     QVI_RMI_FID_GET_DEVICE_IN_CPUSET,
-    QVI_RMI_FID_GET_INTRINSIC_HWPOOL
+    QVI_RMI_FID_GET_INTRINSIC_HWPOOL,
+    QVI_RMI_FID_RESERVE,
+    QVI_RMI_FID_RELEASE,
+    QVI_RMI_FID_STATS,
+    QVI_RMI_FID_BATCH,
+    /** Number of function IDs. Not a valid function ID. */
+    QVI_RMI_FID_LAST
+};
+
+/**
+ * Statistics of the RPCs with a given function ID serviced by a server.
+ * Latencies are kept in log2 histograms: bucket 0 counts latencies under a
+ * microsecond, bucket i > 0 those in [2^(i-1), 2^i) microseconds, and the last
+ * bucket also counts all longer ones.
+ */
+struct qvi_rmi_rpc_stats {
+    /** Number of histogram buckets. */
+    static constexpr size_t nbuckets = 32;
+    /** Number of requests serviced. */
+    uint64_t count = 0;
+    /** Total size of the requests in bytes. */
+    uint64_t bytes_in = 0;
+    /** Total size of the replies in bytes. */
+    uint64_t bytes_out = 0;
+    /** Total time requests waited for a worker in nanoseconds. */
+    uint64_t queue_ns = 0;
+    /** Total time spent servicing requests in nanoseconds. */
+    uint64_t handler_ns = 0;
+    /** Histogram of the time requests waited for a worker. */
+    std::vector<uint64_t> queue_hist = std::vector<uint64_t>(nbuckets);
+    /** Histogram of the time spent servicing requests. */
+    std::vector<uint64_t> handler_hist = std::vector<uint64_t>(nbuckets);
+    /** Returns the histogram bucket of the provided latency. */
+    static size_t
+    bucket(
+        uint64_t ns
+    );
+    /** Serializes a qvi_rmi_rpc_stats. */
+    template <class Archive>
+    void
+    serialize(
+        Archive &archive
+    ) {
+        archive(
+            count, bytes_in, bytes_out, queue_ns, handler_ns,
+            queue_hist, handler_hist
+        );
+    }
+};
+
+/**
+ * RPC schema: the types of an RPC's arguments and of the results returned
+ * alongside its return code. Client-side packing and server-side unpacking are
+ * both generated from it, so adding an RPC only requires a schema and a
+ * server-side qvi_rmi_server::m_rpc() specialization. RPCs without a schema
+ * (e.g., shutdown and batch) are packed and unpacked by hand.
+ */
+template <qvi_rmi_rpc_fid_t FID>
+struct qvi_rmi_rpc_schema;
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_HELLO> {
+    /** Client version, topology flags, and caller. */
+    using args = std::tuple<size_t, qvi_hwloc_flags_t, pid_t>;
+    /**
+     * Topology file, shared-memory topology, and the file publishing the
+     * server's generation.
+     */
+    using results = std::tuple<std::string, qvi_hwloc_shmem, std::string>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUBIND> {
+    /** Topology flags and task. */
+    using args = std::tuple<qvi_hwloc_flags_t, pid_t>;
+    /** The task's cpuset. */
+    using results = std::tuple<qvi_hwloc_bitmap>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_SET_CPUBIND> {
+    /** Topology flags, task, and cpuset. */
+    using args = std::tuple<qvi_hwloc_flags_t, pid_t, qvi_hwloc_bitmap>;
+    using results = std::tuple<>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_SET_CPUBIND_MANY> {
+    /** Topology flags, tasks, and their respective cpusets. */
+    using args = std::tuple<
+        qvi_hwloc_flags_t, std::vector<pid_t>, std::vector<qvi_hwloc_bitmap>
+    >;
+    /** Per-task return codes. */
+    using results = std::tuple<std::vector<int>>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_OBJ_TYPE_DEPTH> {
+    /** Topology flags and object type. */
+    using args = std::tuple<qvi_hwloc_flags_t, qv_hw_obj_type_t>;
+    /** The object type's depth. */
+    using results = std::tuple<int>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_GET_NOBJS_IN_CPUSET> {
+    /** Topology flags, object type, and cpuset. */
+    using args = std::tuple<
+        qvi_hwloc_flags_t, qv_hw_obj_type_t, qvi_hwloc_bitmap
+    >;
+    /** The number of objects. */
+    using results = std::tuple<size_t>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_GET_CPUSET_FOR_NOBJS> {
+    /** Topology flags, cpuset, object type, and number of objects. */
+    using args = std::tuple<
+        qvi_hwloc_flags_t, qvi_hwloc_bitmap, qv_hw_obj_type_t, int
+    >;
+    /** The resulting cpuset. */
+    using results = std::tuple<qvi_hwloc_bitmap>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_GET_DEVICE_IN_CPUSET> {
+    /** Topology flags, device type, device index, cpuset, and ID type. */
+    using args = std::tuple<
+        qvi_hwloc_flags_t, qv_hw_obj_type_t, int,
+        qvi_hwloc_bitmap, qv_device_id_type_t
+    >;
+    /** The device ID. */
+    using results = std::tuple<std::string>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_GET_INTRINSIC_HWPOOL> {
+    /** Topology flags, group members, intrinsic scope, and scope flags. */
+    using args = std::tuple<
+        qvi_hwloc_flags_t, std::vector<pid_t>,
+        qv_scope_intrinsic_t, qv_scope_flags_t
+    >;
+    /** The intrinsic hardware pool. */
+    using results = std::tuple<qvi_hwpool>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_RESERVE> {
+    /** Topology flags, owner, cpuset, object type, and number of objects. */
+    using args = std::tuple<
+        qvi_hwloc_flags_t, pid_t, qvi_hwloc_bitmap, qv_hw_obj_type_t, int
+    >;
+    /** The lease and its hardware pool. */
+    using results = std::tuple<uint64_t, qvi_hwpool>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_RELEASE> {
+    /** Owner and lease. */
+    using args = std::tuple<pid_t, uint64_t>;
+    using results = std::tuple<>;
+};
+
+template <>
+struct qvi_rmi_rpc_schema<QVI_RMI_FID_STATS> {
+    using args = std::tuple<>;
+    /** Statistics indexed by function ID. */
+    using results = std::tuple<std::vector<qvi_rmi_rpc_stats>>;
 };
 
 /**
@@ -44,9 +215,9 @@ enum qvi_rmi_rpc_fid_t {
  * machinery successful?). The underlying target's return code is packed into
  * the message buffer and is meant for client-side consumption.
  */
-using qvi_rmi_rpc_fun_ptr_t = std::function<
-    int(qvi_rmi_server *, qvi_rmi_msg_header *, void *, qvi_bbuff **)
->;
+using qvi_rmi_rpc_fun_ptr_t = int (*)(
+    qvi_rmi_server *, qvi_rmi_msg_header *, void *, qvi_bbuff **
+);
 
 /**
  * Maintains RMI configuration information.
@@ -56,6 +227,97 @@ struct qvi_rmi_config {
     std::string url;
     /** Connection port number. */
     int portno = QVI_PORT_UNSET;
+    /** Number of server worker threads servicing RPCs. */
+    size_t nworkers = 1;
+    /**
+     * Descriptor the server notifies, then closes, once it accepts
+     * connections. -1 if none.
+     */
+    int ready_fd = -1;
+    /**
+     * Directory the server treats as / when following changes to the PUs we
+     * may use, so that tests can fake them. Empty to use / itself.
+     */
+    std::string sysfs_root;
+};
+
+/**
+ * Server-side counterpart of qvi_rmi_rpc_stats updated concurrently by
+ * workers.
+ */
+struct qvi_rmi_rpc_counters {
+    /** Number of requests serviced. */
+    std::atomic<uint64_t> count = 0;
+    /** Total size of the requests in bytes. */
+    std::atomic<uint64_t> bytes_in = 0;
+    /** Total size of the replies in bytes. */
+    std::atomic<uint64_t> bytes_out = 0;
+    /** Total time requests waited for a worker in nanoseconds. */
+    std::atomic<uint64_t> queue_ns = 0;
+    /** Total time spent servicing requests in nanoseconds. */
+    std::atomic<uint64_t> handler_ns = 0;
+    /** Histogram of the time requests waited for a worker. */
+    std::array<
+        std::atomic<uint64_t>, qvi_rmi_rpc_stats::nbuckets
+    > queue_hist = {};
+    /** Histogram of the time spent servicing requests. */
+    std::array<
+        std::atomic<uint64_t>, qvi_rmi_rpc_stats::nbuckets
+    > handler_hist = {};
+    /** Records a serviced request. */
+    void
+    record(
+        size_t req_bytes,
+        size_t rep_bytes,
+        uint64_t wait_ns,
+        uint64_t service_ns
+    );
+    /** Returns a snapshot of the counters. */
+    qvi_rmi_rpc_stats
+    snapshot(void) const;
+};
+
+/** How the reply to a request may be shared with identical requests. */
+enum qvi_rmi_reply_reuse {
+    /** Every request is serviced on its own. */
+    QVI_RMI_REPLY_REUSE_NONE = 0,
+    /** Identical requests in flight share a single reply. */
+    QVI_RMI_REPLY_REUSE_COALESCE,
+    /** Like coalesce, but successful replies are also kept for later ones. */
+    QVI_RMI_REPLY_REUSE_MEMOIZE
+};
+
+/**
+ * A reply shared by identical requests. Filled in by the worker servicing
+ * the first such request, while the others wait for it.
+ */
+struct qvi_rmi_shared_reply {
+    std::mutex mutex;
+    std::condition_variable cv;
+    /** Whether the reply is complete. */
+    bool ready = false;
+    /** Operation status of the servicing worker. */
+    int rc = QV_SUCCESS;
+    /** The reply (header and packed body). */
+    qvi_bbuff reply;
+};
+
+/**
+ * Resources reserved exclusively by a client process, see
+ * qvi_rmi_client::reserve().
+ */
+struct qvi_rmi_lease {
+    /** The process holding the lease. */
+    pid_t owner = 0;
+    /**
+     * When the owner started, which tells it apart from later processes with
+     * its PID. 0 if unknown.
+     */
+    uint64_t owner_start = 0;
+    /** The reserved PUs. */
+    qvi_hwloc_bitmap cpuset;
+    /** The reserved devices, identified by PCI bus ID or name. */
+    std::vector<std::string> devices;
 };
 
 /**
@@ -63,20 +325,94 @@ struct qvi_rmi_config {
  */
 struct qvi_rmi_server {
 private:
-    /** Maps function IDs to function pointers. */
-    std::map<qvi_rmi_rpc_fid_t, qvi_rmi_rpc_fun_ptr_t> m_rpc_dispatch_table;
+    /** Maps function IDs to function pointers, indexed by function ID. */
+    static const std::array<
+        qvi_rmi_rpc_fun_ptr_t, QVI_RMI_FID_LAST
+    > s_rpc_dispatch_table;
     /** Server configuration. */
     qvi_rmi_config m_config;
     /** Maintains information for multiple hardware localities. */
     qvi_hwlocs m_hwlocs;
+    /**
+     * Shared by workers servicing RPCs. Held exclusively while the PUs allowed
+     * in m_hwlocs are updated.
+     */
+    std::shared_mutex m_hwlocs_mutex;
+    /** Directory to which the topologies were exported, if any. */
+    std::string m_topo_export_path;
     /** ZMQ context. */
     void *m_zctx = nullptr;
-    /** Communication socket. */
+    /** Client-facing (front-end) socket. */
     void *m_zsock = nullptr;
-    /** Receives messages. */
+    /** Worker-facing (back-end) socket. */
+    void *m_zworkers = nullptr;
+    /** Socket used by workers to notify the main loop of their exit. */
+    void *m_zcontrol = nullptr;
+    /** File descriptor from which the main loop receives signals. */
+    int m_sigfd = -1;
+    /**
+     * inotify descriptor from which the main loop learns of changes to the
+     * files in m_hwwatch_paths. -1 if they are not watched.
+     */
+    int m_hwwatch_fd = -1;
+    /** Watched files listing the PUs we may use. */
+    std::vector<std::string> m_hwwatch_paths;
+    /** Last seen contents of the watched files. */
+    std::vector<std::string> m_hwwatch_state;
+    /** Worker threads servicing RPCs. */
+    std::vector<std::thread> m_workers;
+    /** Total number of bytes sent by all workers. */
+    std::atomic<size_t> m_bytes_sent = 0;
+    /**
+     * Generation of the server's view of the hardware, sent with every reply.
+     * Increases whenever that view changes, and across server restarts.
+     */
+    std::atomic<uint64_t> m_generation = 0;
+    /** File through which m_generation is published, if any. */
+    std::string m_generation_path;
+    /**
+     * m_generation as seen by clients that map m_generation_path. Updated
+     * once the topologies of that generation are exported.
+     */
+    std::atomic<uint64_t> *m_generation_word = nullptr;
+    /** Per-RPC statistics, indexed by function ID. */
+    std::array<qvi_rmi_rpc_counters, QVI_RMI_FID_LAST> m_stats;
+    /** Protects m_replies. */
+    std::mutex m_replies_mutex;
+    /**
+     * Replies in flight or memoized, keyed by function ID and request body.
+     * Replies to pure queries only change with the allowed PUs, which clears
+     * them.
+     */
+    std::unordered_map<
+        std::string, std::shared_ptr<qvi_rmi_shared_reply>
+    > m_replies;
+    /** Protects the leases below. */
+    std::mutex m_leases_mutex;
+    /** Outstanding leases, keyed by lease ID. */
+    std::map<uint64_t, qvi_rmi_lease> m_leases;
+    /** ID of the next lease. */
+    uint64_t m_next_lease = 1;
+    /**
+     * Drops the leases held by processes that no longer exist. Must be
+     * called with m_leases_mutex held.
+     */
+    void
+    m_reap_leases(void);
+    /** Number of requests answered with another request's reply. */
+    std::atomic<size_t> m_replies_reused = 0;
+    /**
+     * Answers a request keyed by key with a reply shared with identical
+     * requests, calling service(output, reusable) only if none is available.
+     * service sets reusable when the reply may be memoized.
+     */
+    template <typename Service>
     int
-    m_recv_msg(
-        zmq_msg_t *mrx
+    m_rpc_shared(
+        std::string &&key,
+        qvi_rmi_reply_reuse reuse,
+        Service &&service,
+        qvi_bbuff **output
     );
     /** Performs RPC dispatch. */
     int
@@ -85,6 +421,32 @@ private:
         zmq_msg_t *command_msg,
         int *bsent
     );
+    /**
+     * Forwards a multipart message from one socket to another. If stamp is
+     * set, the message is a request whose receipt time, and sender if needed,
+     * are recorded.
+     */
+    static int
+    s_forward_msg(
+        void *from,
+        void *to,
+        bool stamp = false
+    );
+    /** Returns a snapshot of the per-RPC statistics. */
+    std::vector<qvi_rmi_rpc_stats>
+    m_stats_snapshot(void) const;
+    /** Writes the per-RPC statistics to the session directory. */
+    int
+    m_dump_stats(void) const;
+    /** Starts the worker threads. */
+    int
+    m_start_workers(void);
+    /** Stops and joins the worker threads. */
+    void
+    m_stop_workers(void);
+    /** Worker thread main loop. */
+    void
+    m_worker_loop(void);
     /** */
     int
     m_get_iscope_bitmap_user(
@@ -105,87 +467,92 @@ private:
         const std::vector<pid_t> &who,
         qvi_hwloc_bitmap &bitmap
     );
-    /** Executes the main server loop. */
+    /**
+     * Handles pending signals. Returns QV_SUCCESS_SHUTDOWN if the server was
+     * asked to shut down.
+     */
     int
-    m_enter_main_server_loop(void);
-    /** */
-    static int
-    s_rpc_invalid(
-        qvi_rmi_server *,
-        qvi_rmi_msg_header *,
-        void *,
-        qvi_bbuff **
-    );
-    /** */
-    static int
-    s_rpc_shutdown(
-        qvi_rmi_server *,
-        qvi_rmi_msg_header *hdr,
-        void *,
-        qvi_bbuff **output
-    );
-    /** */
-    static int
-    s_rpc_hello(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
-    );
-    /** */
-    static int
-    s_rpc_get_cpubind(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
-    );
-    /** */
-    static int
-    s_rpc_set_cpubind(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
+    m_recv_signals(void);
+    /**
+     * Starts watching the files listing the PUs we may use: the online CPUs
+     * and the effective CPUs of our cgroup cpuset.
+     */
+    int
+    m_hwwatch_start(void);
+    /**
+     * Updates the allowed PUs if the watched files changed. Called when
+     * notified of changes, and periodically since not all are notified.
+     */
+    int
+    m_hwwatch_check(void);
+    /**
+     * Sets the PUs allowed in all topologies, then lets clients know through a
+     * new generation.
+     */
+    int
+    m_topology_allow(
+        const qvi_hwloc_bitmap &cpuset
     );
-    /** */
-    static int
-    s_rpc_obj_type_depth(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
+    /**
+     * Publishes m_generation in a file under the provided directory, which
+     * clients map to learn of new generations without contacting us.
+     */
+    int
+    m_generation_publish(
+        const std::string &base_path
     );
-    /** */
+    /** Executes the main server loop. */
+    int
+    m_enter_main_server_loop(void);
+    /** Builds the dispatch table at compile time. */
+    template <size_t... FIDs>
+    static constexpr std::array<qvi_rmi_rpc_fun_ptr_t, sizeof...(FIDs)>
+    s_make_rpc_dispatch_table(
+        std::index_sequence<FIDs...>
+    ) {
+        return {&s_rpc<qvi_rmi_rpc_fid_t(FIDs)>...};
+    }
+    /**
+     * Unpacks the arguments of the RPC identified by FID, services it, and
+     * packs its reply. Specialized for RPCs without a schema.
+     */
+    template <qvi_rmi_rpc_fid_t FID>
     static int
-    s_rpc_get_nobjs_in_cpuset(
+    s_rpc(
         qvi_rmi_server *server,
         qvi_rmi_msg_header *hdr,
         void *input,
         qvi_bbuff **output
     );
-    static int
-    s_rpc_get_cpuset_for_nobjs(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
+    /**
+     * Returns how replies to the RPC identified by FID given its arguments
+     * may be shared. Only RPCs whose results depend on nothing but their
+     * arguments and the server's topologies may be memoized.
+     */
+    template <qvi_rmi_rpc_fid_t FID>
+    static qvi_rmi_reply_reuse
+    s_reply_reuse(
+        const typename qvi_rmi_rpc_schema<FID>::args &args
     );
-    /** */
-    static int
-    s_rpc_get_device_in_cpuset(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
+    /**
+     * Replaces the process the arguments of the RPC identified by FID name as
+     * the caller with the one we determined from the connection, if any.
+     */
+    template <qvi_rmi_rpc_fid_t FID>
+    static void
+    s_rpc_caller(
+        const qvi_rmi_msg_header &hdr,
+        typename qvi_rmi_rpc_schema<FID>::args &args
     );
-    /** */
-    static int
-    s_rpc_get_intrinsic_hwpool(
-        qvi_rmi_server *server,
-        qvi_rmi_msg_header *hdr,
-        void *input,
-        qvi_bbuff **output
+    /**
+     * Services the RPC identified by FID given its arguments. Returns the RPC's
+     * return code, which is sent to the client along with the results.
+     */
+    template <qvi_rmi_rpc_fid_t FID>
+    int
+    m_rpc(
+        const typename qvi_rmi_rpc_schema<FID>::args &args,
+        typename qvi_rmi_rpc_schema<FID>::results &results
     );
 public:
     /** Constructor. */
@@ -208,52 +575,377 @@ public:
 };
 
 /**
- * RMI client.
+ * Unpacks an RPC's reply into its output arguments. Returns the RPC's return
+ * code.
+ */
+using qvi_rmi_unpack_fun_t = std::function<int(void *)>;
+
+/**
+ * Completion token of an RPC issued asynchronously. The RPC's results are
+ * only written to the output arguments provided when it was issued by wait(),
+ * so they must remain valid until then. Destroying a token that was not waited
+ * on discards the RPC's results.
+ */
+struct qvi_rmi_future {
+    friend qvi_rmi_client;
+private:
+    /** The client that issued the RPC. */
+    const qvi_rmi_client *m_rmi = nullptr;
+    /** The RPC's request ID. */
+    uint64_t m_rid = 0;
+    /** Unpacks the RPC's reply. */
+    qvi_rmi_unpack_fun_t m_unpacker;
+    /** Whether the RPC has yet to be waited on. */
+    bool m_pending = false;
+    /** The RPC's return code, once known. */
+    int m_rc = QV_SUCCESS;
+    /** Discards the results of a pending RPC. */
+    void
+    m_abandon(void);
+public:
+    /** Constructor. */
+    qvi_rmi_future(void) = default;
+    /** Copy constructor. */
+    qvi_rmi_future(const qvi_rmi_future &src) = delete;
+    /** Assignment operator. */
+    void
+    operator=(const qvi_rmi_future &src) = delete;
+    /** Destructor. */
+    ~qvi_rmi_future(void);
+    /** Returns whether the RPC has yet to be waited on. */
+    bool
+    pending(void) const;
+    /**
+     * Waits for the RPC to complete, unpacking its results. Returns the RPC's
+     * return code. Subsequent calls return the same code.
+     */
+    int
+    wait(void);
+};
+
+/**
+ * Collects RPCs that are sent to the server in a single request and whose
+ * results are returned in a single reply. Each operation mirrors its
+ * qvi_rmi_client counterpart, but its results are only written to the provided
+ * output arguments by execute(), so they must remain valid until then.
+ */
+struct qvi_rmi_batch {
+    friend qvi_rmi_client;
+private:
+    /** The client used to execute the batch. */
+    qvi_rmi_client &m_rmi;
+    /** Hardware locality flags used by the batched operations. */
+    qvi_hwloc_flags_t m_flags = QVI_HWLOC_FLAG_TOPO_FULL;
+    /** Packed requests. */
+    qvi_bbuff m_requests;
+    /** Reply unpackers, one per request. */
+    std::vector<qvi_rmi_unpack_fun_t> m_unpackers;
+    /**
+     * Adds a request for the RPC identified by FID to the batch. Its results
+     * are unpacked into the provided output arguments.
+     */
+    template <qvi_rmi_rpc_fid_t FID, typename... Results, typename... Types>
+    int
+    m_add(
+        std::tuple<Results &...> results,
+        Types &&...args
+    );
+public:
+    /** Constructor. */
+    explicit qvi_rmi_batch(
+        qvi_rmi_client &rmi
+    );
+    /** Returns the number of operations in the batch. */
+    size_t
+    size(void) const;
+    /** Adds a get_cpubind() operation. */
+    int
+    get_cpubind(
+        pid_t task_id,
+        qvi_hwloc_bitmap &cpuset
+    );
+    /** Adds a set_cpubind() operation. */
+    int
+    set_cpubind(
+        pid_t task_id,
+        const qvi_hwloc_bitmap &cpuset
+    );
+    /** Adds a get_intrinsic_hwpool() operation. */
+    int
+    get_intrinsic_hwpool(
+        const std::vector<pid_t> &who,
+        qv_scope_intrinsic_t iscope,
+        qv_scope_flags_t flags,
+        qvi_hwpool &hwpool
+    );
+    /** Adds a get_obj_depth() operation. */
+    int
+    get_obj_depth(
+        qv_hw_obj_type_t type,
+        int &depth
+    );
+    /** Adds a get_nobjs_in_cpuset() operation. */
+    int
+    get_nobjs_in_cpuset(
+        qv_hw_obj_type_t target_obj,
+        const qvi_hwloc_bitmap &cpuset,
+        size_t &nobjs
+    );
+    /** Adds a get_device_in_cpuset() operation. */
+    int
+    get_device_in_cpuset(
+        qv_hw_obj_type_t dev_obj,
+        int dev_i,
+        const qvi_hwloc_bitmap &cpuset,
+        qv_device_id_type_t dev_id_type,
+        std::string &dev_id
+    );
+    /** Adds a get_cpuset_for_nobjs() operation. */
+    int
+    get_cpuset_for_nobjs(
+        const qvi_hwloc_bitmap &cpuset,
+        qv_hw_obj_type_t obj_type,
+        int nobjs,
+        qvi_hwloc_bitmap &result
+    );
+    /**
+     * Sends all operations to the server in one request and unpacks their
+     * results. Every operation is performed, but the return code of the first
+     * one that failed, if any, is returned. Empties the batch.
+     */
+    int
+    execute(void);
+};
+
+/**
+ * RMI client. A client may be shared by threads: its RPCs are serialized.
  */
 struct qvi_rmi_client {
+    friend qvi_rmi_batch;
+    friend qvi_rmi_future;
 private:
     /** Client configuration. */
     qvi_rmi_config m_config;
-    /** Maintains hardware locality information. */
-    qvi_hwloc m_hwloc;
+    /**
+     * Maintains hardware locality information. Shared with the other
+     * clients in this process that use the same topology. Replaced when the
+     * server's generation changes: use m_topology() to access it.
+     */
+    mutable std::shared_ptr<qvi_hwloc> m_hwloc = std::make_shared<qvi_hwloc>();
+    /** Flags of the topology we use. */
+    qvi_hwloc_flags_t m_hwloc_flags = QVI_HWLOC_FLAG_EMPTY;
+    /** Topology file exported by the server, if any. */
+    std::string m_hwtopo_path;
+    /** Shared-memory topology published by the server, if any. */
+    qvi_hwloc_shmem m_hwtopo_shmem;
+    /** Protects m_hwloc and the topology state below. */
+    mutable std::mutex m_hwloc_mutex;
+    /** Server generation m_hwloc was loaded in. */
+    mutable uint64_t m_hwloc_generation = 0;
     /** ZMQ context. */
     void *m_zctx = nullptr;
     /** Communication socket. */
     void *m_zsock = nullptr;
     /** Flag indicating whether client is connected to server. */
     bool m_connected = false;
+    /**
+     * Protects the reply bookkeeping below. Also serializes use of the
+     * socket, except while a thread waits for replies on it.
+     */
+    mutable std::mutex m_mutex;
+    /** Time to wait for a reply before giving up on it. */
+    static constexpr int s_recv_timeout_ms = 5000;
+    /**
+     * Whether a thread is waiting for replies on the socket, which it then
+     * uses without holding m_mutex. Only one thread does so at a time.
+     */
+    mutable bool m_receiving = false;
+    /** Signals the arrival of replies and the end of m_receiving. */
+    mutable std::condition_variable m_recv_cv;
+    /** Requests that the receiving thread is to send on our behalf. */
+    mutable std::vector<std::pair<uint64_t, qvi_bbuff *>> m_outbox;
+    /** Wakes the receiving thread up to send the requests in m_outbox. */
+    int m_wakefd = -1;
+    /** ID of the next request. */
+    mutable uint64_t m_next_rid = 1;
+    /** Replies received before they were waited on, keyed by request ID. */
+    mutable std::map<uint64_t, zmq_msg_t> m_replies;
+    /** IDs of requests whose replies are to be discarded. */
+    mutable std::set<uint64_t> m_abandoned;
+    /** IDs of requests in m_outbox that could not be sent. */
+    mutable std::set<uint64_t> m_unsent;
+    /** A set_cpubind() request waiting to be combined with others. */
+    struct bind_request {
+        pid_t who = 0;
+        const qvi_hwloc_bitmap *cpuset = nullptr;
+        int rc = QV_SUCCESS;
+        bool done = false;
+    };
+    /** Protects the bind-request state below. */
+    std::mutex m_bind_mutex;
+    /** Signals the completion of combined bind requests. */
+    std::condition_variable m_bind_cv;
+    /** Bind requests waiting for the next combined RPC. */
+    std::vector<bind_request *> m_bind_queue;
+    /** Whether a combined bind RPC is in flight. */
+    bool m_binding = false;
+    /** Number of entries each query cache holds. */
+    static constexpr size_t s_cache_capacity = 64;
+    /** Protects the query caches and generation below. */
+    mutable std::mutex m_cache_mutex;
+    /** The latest server generation seen. */
+    mutable uint64_t m_generation = 0;
+    /**
+     * The server's generation word, read without contacting the server. Not
+     * available if the server does not publish one.
+     */
+    const std::atomic<uint64_t> *m_generation_word = nullptr;
+    /** Cached user-scope intrinsic hardware pools. */
+    mutable qvi_lru_cache<std::string, qvi_hwpool> m_hwpool_cache{
+        s_cache_capacity
+    };
+    /** Cached device IDs. */
+    mutable qvi_lru_cache<std::string, std::string> m_devid_cache{
+        s_cache_capacity
+    };
+    /**
+     * Notes the server's generation sent with a reply, dropping the cached
+     * query results if it changed.
+     */
+    void
+    m_observe_generation(
+        uint64_t gen
+    ) const;
+    /** Observes the server's current generation, if published. */
+    void
+    m_check_generation(void) const;
+    /**
+     * Returns the topology of the server's current generation, loading it
+     * first if the generation changed.
+     */
+    std::shared_ptr<qvi_hwloc>
+    m_topology(void) const;
+    /** Maps the server's generation word published at the provided path. */
+    int
+    m_map_generation(
+        const std::string &path
+    );
+    /**
+     * Looks up a cached query result. Also returns the current generation,
+     * which is to be passed to m_cache_put() should the lookup fail.
+     */
+    template <typename Value>
+    bool
+    m_cache_get(
+        qvi_lru_cache<std::string, Value> &cache,
+        const std::string &key,
+        Value &value,
+        uint64_t &gen
+    ) const;
+    /**
+     * Caches a query result, unless the generation changed since the
+     * corresponding m_cache_get().
+     */
+    template <typename Value>
+    void
+    m_cache_put(
+        qvi_lru_cache<std::string, Value> &cache,
+        const std::string &key,
+        const Value &value,
+        uint64_t gen
+    ) const;
     /** Receives messages. */
     int
     m_recv_msg(
         zmq_msg_t *mrx
     ) const;
-    /** Performs RPC reply. */
-    template <typename... Types>
+    /**
+     * Receives the reply to the provided request, waiting for it on the
+     * socket while other threads wait for theirs on m_recv_cv.
+     */
     int
-    rpc_rep(
-        Types &&...args
+    m_recv_reply(
+        uint64_t rid,
+        zmq_msg_t *mrx
+    ) const;
+    /**
+     * Receives replies on behalf of all waiters until the reply to the
+     * provided request arrives. Called as the receiving thread.
+     */
+    int
+    m_recv_replies(
+        uint64_t rid,
+        zmq_msg_t *mrx,
+        std::unique_lock<std::mutex> &lock
+    ) const;
+    /** Sends a request that already carries its request ID. */
+    int
+    m_send_msg(
+        qvi_bbuff *bbuff
+    ) const;
+    /** Sends the requests queued in m_outbox. */
+    void
+    m_send_outbox(void) const;
+    /** Discards the reply to the provided request. */
+    void
+    m_abandon(
+        uint64_t rid
+    ) const;
+    /** Sends a request, assigning it a request ID. */
+    int
+    m_send(
+        qvi_bbuff *bbuff,
+        uint64_t &rid
     ) const;
     /** Performs RPC request. */
     template <typename... Types>
     int
     rpc_req(
+        uint64_t &rid,
         qvi_rmi_rpc_fid_t fid,
         Types &&...args
     ) const;
+    /** Completes the provided future locally with the provided return code. */
+    int
+    m_complete(
+        qvi_rmi_future &future,
+        int rc
+    ) const;
+    /**
+     * Issues the RPC identified by FID. Its results are unpacked into the
+     * provided output arguments when the provided future is waited on.
+     */
+    template <qvi_rmi_rpc_fid_t FID, typename... Results, typename... Types>
+    int
+    m_issue(
+        qvi_rmi_future &future,
+        std::tuple<Results &...> results,
+        Types &&...args
+    ) const;
+    /** Performs a batch of RPCs in a single round trip. */
+    int
+    m_batch(
+        qvi_rmi_batch &batch
+    ) const;
     /** Performs connection handshake. */
     int
     m_hello(
         size_t client_version,
         qvi_hwloc_flags_t flags,
-        std::string &hwtopo_path
+        std::string &hwtopo_path,
+        qvi_hwloc_shmem &hwtopo_shmem,
+        std::string &generation_path
     );
 public:
     /** Constructor. */
     qvi_rmi_client(void) = default;
     /** Destructor. */
     ~qvi_rmi_client(void);
-    /** Returns a pointer to the client's hwloc instance given the provided type. */
-    qvi_hwloc &
+    /**
+     * Returns the client's hwloc instance. It may be replaced when the server's
+     * view of the hardware changes, so hold on to it only as long as needed.
+     */
+    std::shared_ptr<qvi_hwloc>
     hwloc(void);
     /** Discovers server connection information. */
     static int
@@ -273,12 +965,109 @@ public:
         pid_t task_id,
         qvi_hwloc_bitmap &cpuset
     ) const;
-    /** Sets the cpuset of the provided PID. */
+    /**
+     * Sets the cpuset of the provided PID. Requests issued concurrently by
+     * several threads are combined into one set_cpubind() of many tasks.
+     */
     int
     set_cpubind(
         pid_t task_id,
         const qvi_hwloc_bitmap &cpuset
     );
+    /**
+     * Sets the cpusets of the provided PIDs in a single request. Every task
+     * is bound, but the return code of the first failure, if any, is
+     * returned.
+     */
+    int
+    set_cpubind(
+        const std::vector<pid_t> &task_ids,
+        const std::vector<qvi_hwloc_bitmap> &cpusets
+    );
+    /**
+     * Returns the current cpuset of the calling thread. Queries it directly
+     * when possible; otherwise, asks the server.
+     */
+    int
+    get_my_cpubind(
+        qvi_hwloc_bitmap &cpuset
+    );
+    /**
+     * Sets the cpuset of the calling thread. Binds directly when possible;
+     * otherwise, asks the server to.
+     */
+    int
+    set_my_cpubind(
+        const qvi_hwloc_bitmap &cpuset
+    );
+    /** Asynchronous version of get_cpubind(). */
+    int
+    get_cpubind_async(
+        pid_t task_id,
+        qvi_hwloc_bitmap &cpuset,
+        qvi_rmi_future &future
+    ) const;
+    /** Asynchronous version of set_cpubind(). */
+    int
+    set_cpubind_async(
+        pid_t task_id,
+        const qvi_hwloc_bitmap &cpuset,
+        qvi_rmi_future &future
+    ) const;
+    /**
+     * Asynchronous version of set_cpubind() of many tasks. The per-task return
+     * codes are stored in rcs.
+     */
+    int
+    set_cpubind_async(
+        const std::vector<pid_t> &task_ids,
+        const std::vector<qvi_hwloc_bitmap> &cpusets,
+        std::vector<int> &rcs,
+        qvi_rmi_future &future
+    ) const;
+    /** Asynchronous version of get_intrinsic_hwpool(). */
+    int
+    get_intrinsic_hwpool_async(
+        const std::vector<pid_t> &who,
+        qv_scope_intrinsic_t iscope,
+        qv_scope_flags_t flags,
+        qvi_hwpool &hwpool,
+        qvi_rmi_future &future
+    ) const;
+    /** Asynchronous version of get_obj_depth(). */
+    int
+    get_obj_depth_async(
+        qv_hw_obj_type_t type,
+        int &depth,
+        qvi_rmi_future &future
+    ) const;
+    /** Asynchronous version of get_nobjs_in_cpuset(). */
+    int
+    get_nobjs_in_cpuset_async(
+        qv_hw_obj_type_t target_obj,
+        const qvi_hwloc_bitmap &cpuset,
+        size_t &nobjs,
+        qvi_rmi_future &future
+    ) const;
+    /** Asynchronous version of get_device_in_cpuset(). */
+    int
+    get_device_in_cpuset_async(
+        qv_hw_obj_type_t dev_obj,
+        int dev_i,
+        const qvi_hwloc_bitmap &cpuset,
+        qv_device_id_type_t dev_id_type,
+        std::string &dev_id,
+        qvi_rmi_future &future
+    ) const;
+    /** Asynchronous version of get_cpuset_for_nobjs(). */
+    int
+    get_cpuset_for_nobjs_async(
+        const qvi_hwloc_bitmap &cpuset,
+        qv_hw_obj_type_t obj_type,
+        int nobjs,
+        qvi_hwloc_bitmap &result,
+        qvi_rmi_future &future
+    ) const;
     /**
      * Returns a new hardware pool based on
      * the intrinsic scope specifier and flags.
@@ -290,7 +1079,11 @@ public:
         qv_scope_flags_t flags,
         qvi_hwpool &hwpool
     );
-    /** Returns the depth of the provided object type. */
+    /**
+     * Returns the depth of the provided object type. This and the other
+     * queries that depend only on the hardware topology are answered locally
+     * from the topology shared by the server, without a round trip.
+     */
     int
     get_obj_depth(
         qv_hw_obj_type_t type,
@@ -303,6 +1096,16 @@ public:
         const qvi_hwloc_bitmap &cpuset,
         size_t &nobjs
     );
+    /**
+     * Returns the number of objects of each of the provided types in the
+     * provided cpuset.
+     */
+    int
+    get_nobjs_in_cpuset(
+        const std::vector<qv_hw_obj_type_t> &target_objs,
+        const qvi_hwloc_bitmap &cpuset,
+        std::vector<size_t> &nobjs
+    );
     /** Returns a device ID string for the requested device. */
     int
     get_device_in_cpuset(
@@ -320,15 +1123,50 @@ public:
         int nobjs,
         qvi_hwloc_bitmap &result
     );
+    /**
+     * Reserves nobjs objects of the provided type within the provided cpuset
+     * for the calling process, along with the devices with affinity to them.
+     * Resources reserved by other processes are never handed out, so
+     * QV_RES_UNAVAILABLE is returned when too few remain. The reservation
+     * lasts until it is released or the calling process exits.
+     */
+    int
+    reserve(
+        const qvi_hwloc_bitmap &cpuset,
+        qv_hw_obj_type_t obj_type,
+        int nobjs,
+        uint64_t &lease,
+        qvi_hwpool &hwpool
+    ) const;
+    /** Releases a lease obtained through reserve(). */
+    int
+    release(
+        uint64_t lease
+    ) const;
+    /** Returns the server's per-RPC statistics, indexed by function ID. */
+    int
+    get_stats(
+        std::vector<qvi_rmi_rpc_stats> &stats
+    ) const;
     /** Sends a shutdown message to the server. */
     int
     send_shutdown_message(void);
 };
 
+/**
+ * Returns the name of the provided function ID.
+ */
+cstr_t
+qvi_rmi_rpc_fid_name(
+    qvi_rmi_rpc_fid_t fid
+);
+
 /**
  * Returns a connection URL. When called with a portno of QVI_COMM_PORT_UNSET,
  * then a valid portno is determined via an environment variable and returned.
  * If portno is set, then a URL is generated based on the provided port number.
+ * The URL names a Unix-domain socket in the session directory when possible;
+ * otherwise, it names a loopback TCP endpoint.
  */
 int
 qvi_rmi_get_url(
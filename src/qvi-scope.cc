@@ -23,12 +23,20 @@
 
 qv_scope::qv_scope(
     qvi_group *group,
-    qvi_hwpool &hwpool
+    qvi_hwpool &hwpool,
+    uint64_t lease
 ) : m_group(group)
-  , m_hwpool(hwpool) { }
+  , m_hwpool(hwpool)
+  , m_lease(lease) { }
 
 qv_scope::~qv_scope(void)
 {
+    if (m_lease != 0) {
+        const int rc = m_group->task().rmi().release(m_lease);
+        if (qvi_unlikely(rc != QV_SUCCESS)) {
+            qvi_log_warn("Failed to release lease {} ({})", m_lease, rc);
+        }
+    }
     m_group->release();
 }
 
@@ -59,9 +67,7 @@ qv_scope::make_intrinsic(
     if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
     // Get the requested intrinsic hardware pool.
     qvi_hwpool hwpool;
-    rc = group->task().rmi().get_intrinsic_hwpool(
-        group->pids(), iscope, flags, hwpool
-    );
+    rc = group->intrinsic_hwpool(iscope, flags, hwpool);
     if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
     // Create and initialize the scope.
     rc = qvi_new(scope, group, hwpool);
@@ -71,10 +77,10 @@ qv_scope::make_intrinsic(
     return rc;
 }
 
-// TODO(skg) Implement use of hints.
+// TODO(skg) Implement use of QV_SCOPE_FLAG_HINT_CLOSE.
 int
 qv_scope::create(
-    qv_scope_flags_t,
+    qv_scope_flags_t flags,
     qv_hw_obj_type_t type,
     int nobjs,
     qv_scope_t **child
@@ -84,27 +90,42 @@ qv_scope::create(
     qvi_group *group = nullptr;
     int rc = m_group->self(&group);
     if (rc != QV_SUCCESS) return rc;
-    // Get the appropriate cpuset based on the caller's request.
-    qvi_hwloc_bitmap cpuset;
-    rc = m_group->task().rmi().get_cpuset_for_nobjs(
-        m_hwpool.cpuset(), type, nobjs, cpuset
-    );
-    if (rc != QV_SUCCESS) {
-        qvi_delete(&group);
-        return rc;
-    }
-    // Now that we have the desired cpuset,
-    // initialize the new hardware pool.
+
     qvi_hwpool hwpool;
-    rc = hwpool.populate(m_group->hwloc(), cpuset);
-    if (rc != QV_SUCCESS) {
-        qvi_delete(&group);
-        return rc;
+    uint64_t lease = 0;
+    if (flags & QV_SCOPE_FLAG_HINT_EXCLUSIVE) {
+        // The server picks the resources, skipping those leased by others.
+        rc = m_group->task().rmi().reserve(
+            m_hwpool.cpuset(), type, nobjs, lease, hwpool
+        );
+        if (rc != QV_SUCCESS) {
+            qvi_delete(&group);
+            return rc;
+        }
+    }
+    else {
+        // Get the appropriate cpuset based on the caller's request.
+        qvi_hwloc_bitmap cpuset;
+        rc = m_group->task().rmi().get_cpuset_for_nobjs(
+            m_hwpool.cpuset(), type, nobjs, cpuset
+        );
+        if (rc != QV_SUCCESS) {
+            qvi_delete(&group);
+            return rc;
+        }
+        // Now that we have the desired cpuset,
+        // initialize the new hardware pool.
+        rc = hwpool.populate(*m_group->hwloc(), cpuset);
+        if (rc != QV_SUCCESS) {
+            qvi_delete(&group);
+            return rc;
+        }
     }
     // Create and initialize the new scope.
     qv_scope_t *ichild = nullptr;
-    rc = qvi_new(&ichild, group, hwpool);
+    rc = qvi_new(&ichild, group, hwpool, lease);
     if (rc != QV_SUCCESS) {
+        if (lease != 0) (void)m_group->task().rmi().release(lease);
         qvi_delete(&ichild);
     }
     *child = ichild;
@@ -139,7 +160,7 @@ size_t
 qv_scope::hwpool_nobjects(
     qv_hw_obj_type_t obj
 ) const {
-    return m_hwpool.nobjects(m_group->hwloc(), obj);
+    return m_hwpool.nobjects(*m_group->hwloc(), obj);
 }
 
 int
@@ -190,7 +211,7 @@ qv_scope::bind_string(
     const int rc = m_group->task().bind_top(bitmap);
     if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
 
-    return m_group->hwloc().bind_string(bitmap.cdata(), flags, result);
+    return m_group->hwloc()->bind_string(bitmap.cdata(), flags, result);
 }
 
 int
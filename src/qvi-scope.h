@@ -27,13 +27,16 @@ private:
     qvi_group *m_group = nullptr;
     /** Hardware resource pool. */
     qvi_hwpool m_hwpool;
+    /** Lease on the hardware pool if it is held exclusively, 0 otherwise. */
+    uint64_t m_lease = 0;
 public:
     /** Constructor */
     qv_scope(void) = delete;
     /** Constructor */
     qv_scope(
         qvi_group *group,
-        qvi_hwpool &hwpool
+        qvi_hwpool &hwpool,
+        uint64_t lease = 0
     );
     /** Destructor */
     ~qv_scope(void);
@@ -47,7 +50,10 @@ public:
     );
     /**
      * Creates a new scope based on the specified
-     * flags, hardware type, and number of resources.
+     * flags, hardware type, and number of resources. With
+     * QV_SCOPE_FLAG_HINT_EXCLUSIVE, the resources are reserved through the
+     * server until the new scope is freed, so no other exclusive scope gets
+     * them in the meantime.
      */
     int
     create(
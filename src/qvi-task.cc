@@ -26,19 +26,37 @@ qvi_task::mytid(void)
 qvi_rmi_client &
 qvi_task::rmi(void)
 {
-    return m_rmi;
+    return *m_rmi;
 }
 
-qvi_hwloc &
+std::shared_ptr<qvi_hwloc>
 qvi_task::hwloc(void)
 {
-    return m_rmi.hwloc();
+    return m_rmi->hwloc();
 }
 
 int
 qvi_task::m_connect_to_server(
     qv_scope_flags_t flags
 ) {
+    // Connections are keyed by process, since they cannot be used across a
+    // fork(), and by the flags that select the server topology they use.
+    using key_t = std::pair<pid_t, qv_scope_flags_t>;
+    static std::mutex mutex;
+    static std::map<key_t, std::weak_ptr<qvi_rmi_client>> clients;
+
+    const key_t key = {getpid(), flags & QV_SCOPE_FLAG_NO_SMT};
+    // Held while connecting so concurrent callers share one connection.
+    std::lock_guard<std::mutex> guard(mutex);
+    // Reuse an existing connection, if there is one.
+    m_rmi = clients[key].lock();
+    if (m_rmi) return QV_SUCCESS;
+
+    std::shared_ptr<qvi_rmi_client> rmi;
+    try {
+        rmi = std::make_shared<qvi_rmi_client>();
+    }
+    qvi_catch_and_return();
     // Discover the server's port number.
     int portno = QVI_PORT_UNSET;
     int rc = qvi_rmi_client::discover(portno);
@@ -54,7 +72,7 @@ qvi_task::m_connect_to_server(
         return QV_RES_UNAVAILABLE;
     }
 
-    rc = m_rmi.connect(flags, url, portno);
+    rc = rmi->connect(flags, url, portno);
     if (qvi_unlikely(rc != QV_SUCCESS)) {
         const std::string tids = std::to_string(qvi_gettid());
         std::string msg;
@@ -74,8 +92,11 @@ qvi_task::m_connect_to_server(
                 break;
         }
         qvi_log_error("{}", qvi_sbanner(msg, qvi_maxolen));
+        return rc;
     }
-    return rc;
+    m_rmi = rmi;
+    clients[key] = rmi;
+    return QV_SUCCESS;
 }
 
 int
@@ -83,7 +104,7 @@ qvi_task::m_init_bind_stack(void)
 {
     // Cache current binding.
     qvi_hwloc_bitmap current_bind;
-    const int rc = m_rmi.get_cpubind(mytid(), current_bind);
+    const int rc = m_rmi->get_my_cpubind(current_bind);
     if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
 
     m_stack.push(current_bind);
@@ -106,7 +127,7 @@ qvi_task::bind_push(
     const qvi_hwloc_bitmap &cpuset
 ) {
     // Change policy.
-    const int rc = m_rmi.set_cpubind(mytid(), cpuset);
+    const int rc = m_rmi->set_my_cpubind(cpuset);
     if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
     // Push bitmap onto stack.
     m_stack.push(cpuset);
@@ -121,7 +142,7 @@ qvi_task::bind_pop(void)
     m_stack.pop();
     // A pop without a matching push?
     if (qvi_unlikely(m_stack.empty())) return QV_ERR;
-    return m_rmi.set_cpubind(mytid(), m_stack.top());
+    return m_rmi->set_my_cpubind(m_stack.top());
 }
 
 int
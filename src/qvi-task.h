@@ -1,6 +1,6 @@
 /* -*- Mode: C++; c-basic-offset:4; indent-tabs-mode:nil -*- */
 /*
- * Copyright (c) 2020-2025 Triad National Security, LLC
+ * Copyright (c) 2020-2026 Triad National Security, LLC
  *                         All rights reserved.
  *
  * Copyright (c) 2020-2021 Lawrence Livermore National Security, LLC
@@ -25,8 +25,11 @@ using qvi_task_bind_stack = std::stack<qvi_hwloc_bitmap>;
 
 struct qvi_task {
 private:
-    /** Client-side connection to the RMI. */
-    qvi_rmi_client m_rmi;
+    /**
+     * Client-side connection to the RMI. Shared by all
+     * the tasks in this process that use the same topology.
+     */
+    std::shared_ptr<qvi_rmi_client> m_rmi;
     /** The task's bind stack. */
     qvi_task_bind_stack m_stack;
     /** Implements the RMI server connection. */
@@ -58,8 +61,8 @@ public:
     /** Returns a reference to the task's RMI. */
     qvi_rmi_client &
     rmi(void);
-    /** Returns a reference to the task's hwloc. */
-    qvi_hwloc &
+    /** Returns the task's hwloc. */
+    std::shared_ptr<qvi_hwloc>
     hwloc(void);
     /**
      * Changes the task's affinity based on the provided cpuset.
@@ -79,6 +79,53 @@ qvi_access(
     return true;
 }
 
+bool
+qvi_private_dir(
+    const std::string &path,
+    bool create
+) {
+    if (create && mkdir(path.c_str(), 0700) == -1 && errno != EEXIST) {
+        return false;
+    }
+    struct stat st;
+    return lstat(path.c_str(), &st) == 0 &&
+           S_ISDIR(st.st_mode) &&
+           st.st_uid == geteuid() &&
+           (st.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+std::string
+qvi_read_file(
+    const std::string &path
+) {
+    std::ifstream in(path);
+    if (!in) return std::string();
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+int
+qvi_write_file_atomic(
+    const std::string &path,
+    const char *data,
+    size_t len
+) {
+    const std::string tmp_path = path + "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(data, len);
+        out.close();
+        if (qvi_unlikely(!out)) {
+            (void)unlink(tmp_path.c_str());
+            return QV_ERR_FILE_IO;
+        }
+    }
+    if (qvi_unlikely(rename(tmp_path.c_str(), path.c_str()) != 0)) {
+        (void)unlink(tmp_path.c_str());
+        return QV_ERR_FILE_IO;
+    }
+    return QV_SUCCESS;
+}
+
 int
 qvi_stoi(
     const std::string &str,
@@ -228,6 +275,111 @@ qvi_tmpdir(void)
     return std::string("/tmp");
 }
 
+std::string
+qvi_session_dir(
+    int portno
+) {
+    return qvi_tmpdir() + "/" + QVI_DAEMON_NAME + "." + std::to_string(portno);
+}
+
+std::string
+qvi_cache_dir(void)
+{
+    return qvi_tmpdir() + "/" + QVI_DAEMON_NAME + "-cache."
+         + std::to_string(geteuid());
+}
+
+/**
+ * Returns the directory holding the session records of the calling user.
+ */
+static std::string
+session_record_dir(void)
+{
+    return qvi_tmpdir() + "/" + QVI_DAEMON_NAME + "-sessions."
+         + std::to_string(geteuid());
+}
+
+std::string
+qvi_session_record_path(
+    int portno
+) {
+    return session_record_dir() + "/" + std::to_string(portno);
+}
+
+/**
+ * Describes a session as published by its server.
+ */
+struct qvi_session_record {
+    /** Version of the server. */
+    size_t version = 0;
+    /** PID of the server. */
+    pid_t pid = 0;
+    /** Port of the session. */
+    int portno = QVI_PORT_UNSET;
+};
+
+/**
+ * Reads the record of the session associated with the provided port.
+ */
+static int
+session_record_read(
+    int portno,
+    qvi_session_record &record
+) {
+    std::istringstream in(qvi_read_file(qvi_session_record_path(portno)));
+    std::string key;
+    while (in >> key) {
+        if (key == "version") in >> record.version;
+        else if (key == "pid") in >> record.pid;
+        else if (key == "port") in >> record.portno;
+        // Clients derive the endpoint from the port, so skip fields we don't
+        // use, such as those written by other builds.
+        else std::getline(in, key);
+    }
+    if (!in.eof() || record.portno != portno) return QV_ERR_NOT_FOUND;
+    return QV_SUCCESS;
+}
+
+int
+qvi_session_publish(
+    int portno
+) {
+    if (!qvi_private_dir(session_record_dir(), true)) return QV_ERR_FILE_IO;
+
+    const std::string record =
+        "version " + std::to_string(QVI_0xVERSION) + "\n"
+      + "pid " + std::to_string(getpid()) + "\n"
+      + "port " + std::to_string(portno) + "\n";
+    return qvi_write_file_atomic(
+        qvi_session_record_path(portno), record.c_str(), record.size()
+    );
+}
+
+int
+qvi_session_unpublish(
+    int portno
+) {
+    // Only remove our own record.
+    qvi_session_record record;
+    const int rc = session_record_read(portno, record);
+    if (rc != QV_SUCCESS || record.pid != getpid()) return QV_SUCCESS;
+
+    const std::string path = qvi_session_record_path(portno);
+    if (qvi_unlikely(unlink(path.c_str()) != 0)) return QV_ERR_FILE_IO;
+    return QV_SUCCESS;
+}
+
+std::string
+qvi_session_ipc_path(
+    int portno
+) {
+    static const std::string ipc_name = "rmi.sock";
+    const std::string path = qvi_session_dir(portno) + "/" + ipc_name;
+    // Must fit, including the terminating NUL, in sockaddr_un.sun_path.
+    if (path.size() >= sizeof(sockaddr_un::sun_path)) return std::string();
+    return path;
+}
+
 int
 qvi_file_size(
     const std::string &path,
@@ -346,28 +498,108 @@ get_portno_from_pid_environ(
     return QVI_PORT_UNSET;
 }
 
+/**
+ * Returns whether the provided record describes a live session we can use.
+ * Records outlive servers that do not exit cleanly, so check that the server
+ * is still running and its PID was not reused.
+ */
+static bool
+session_record_live(
+    const qvi_session_record &record
+) {
+    if (record.version != QVI_0xVERSION || record.pid <= 0) return false;
+    if (kill(record.pid, 0) == -1 && errno != EPERM) return false;
+    const std::string comm = "/proc/" + std::to_string(record.pid) + "/comm";
+    return qvi_read_file(comm) == QVI_DAEMON_NAME + "\n";
+}
+
+/**
+ * Discovers a session from the records published by servers.
+ */
+static int
+discover_from_records(
+    int &target_port
+) {
+    namespace fs = std::filesystem;
+
+    const std::string dir = session_record_dir();
+    if (!qvi_private_dir(dir, false)) return QV_ERR_NOT_FOUND;
+
+    qvi_session_record record;
+    if (target_port != QVI_PORT_UNSET) {
+        const int rc = session_record_read(target_port, record);
+        if (rc == QV_SUCCESS && session_record_live(record)) return rc;
+        return QV_ERR_NOT_FOUND;
+    }
+    // A session that isn't (yet) serving over IPC, used as a last resort.
+    int fallback_port = QVI_PORT_UNSET;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        // Skip anything that isn't a record (e.g., partially written ones).
+        if (name.size() > 5 ||
+            name.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        const int port = qvi_stoi(name);
+        record = qvi_session_record();
+        if (session_record_read(port, record) != QV_SUCCESS) continue;
+        if (!session_record_live(record)) continue;
+        // The caller doesn't care which port to use,
+        // so prefer a session that is serving over IPC.
+        const std::string ipc_path = qvi_session_ipc_path(port);
+        int eno = 0;
+        if (!ipc_path.empty() && qvi_access(ipc_path, F_OK, &eno)) {
+            target_port = port;
+            return QV_SUCCESS;
+        }
+        if (fallback_port == QVI_PORT_UNSET) fallback_port = port;
+    }
+    if (fallback_port != QVI_PORT_UNSET) {
+        target_port = fallback_port;
+        return QV_SUCCESS;
+    }
+    return QV_ERR_NOT_FOUND;
+}
+
 static int
 discover_impl(
     int &target_port
 ) {
+    // Published session records make this an O(1) lookup.
+    if (discover_from_records(target_port) == QV_SUCCESS) return QV_SUCCESS;
+    // Else fall back to scanning /proc, which also finds
+    // servers that could not publish a record.
     std::vector<pid_t> pids;
     int rc = qvi_running(QVI_DAEMON_NAME, pids);
     if (qvi_unlikely(rc != QV_SUCCESS)) return rc;
 
+    // A session that isn't (yet) serving over IPC, used as a last resort.
+    int fallback_port = QVI_PORT_UNSET;
     for (const auto &pid : pids) {
         int port = get_portno_from_pid_cmdline(pid);
         if (port == QVI_PORT_UNSET) {
             port = get_portno_from_pid_environ(pid);
             if (port == QVI_PORT_UNSET) continue;
         }
-        // The caller doesn't care which port to use.
+        // The caller doesn't care which port to use,
+        // so prefer a session that is serving over IPC.
         if (target_port == QVI_PORT_UNSET) {
-            target_port = port;
-            return QV_SUCCESS;
+            const std::string ipc_path = qvi_session_ipc_path(port);
+            int eno = 0;
+            if (!ipc_path.empty() && qvi_access(ipc_path, F_OK, &eno)) {
+                target_port = port;
+                return QV_SUCCESS;
+            }
+            if (fallback_port == QVI_PORT_UNSET) fallback_port = port;
         }
         // Found a daemon that is using the requested port.
         else if (target_port == port) return QV_SUCCESS;
     }
+    if (fallback_port != QVI_PORT_UNSET) {
+        target_port = fallback_port;
+        return QV_SUCCESS;
+    }
     return QV_ERR_NOT_FOUND;
 }
 
@@ -381,11 +613,49 @@ qvi_session_discover(
     return discover_with_backoff(discover_impl, portno, max_timeout_in_ms);
 }
 
+/**
+ * Waits for a daemon we started to report that it is ready through the
+ * provided pipe. The daemon closes the pipe without writing to it if it exits
+ * before becoming ready.
+ */
+static int
+wait_for_daemon_ready(
+    int ready_fd
+) {
+    // Generous, since a cold start discovers the hardware topology.
+    static constexpr int timeout_in_ms = 30000;
+
+    struct pollfd pfd = {ready_fd, POLLIN, 0};
+    int rc = 0;
+    do {
+        rc = poll(&pfd, 1, timeout_in_ms);
+    } while (rc == -1 && errno == EINTR);
+    // Not ready yet, so leave it to discovery.
+    if (rc == 0) {
+        qvi_log_warn("{} is not ready yet", QVI_DAEMON_NAME);
+        return QV_SUCCESS;
+    }
+    char ready = 0;
+    ssize_t nread = 0;
+    do {
+        nread = read(ready_fd, &ready, sizeof(ready));
+    } while (nread == -1 && errno == EINTR);
+    if (qvi_unlikely(nread != sizeof(ready))) return QV_ERR_SYS;
+    return QV_SUCCESS;
+}
+
 int
 qvi_start_quo_vadisd(
     int portno
 ) {
     const auto dname = QVI_DAEMON_NAME;
+    // The daemon reports that it is ready through this pipe.
+    int ready_fds[2] = {-1, -1};
+    if (qvi_unlikely(pipe2(ready_fds, O_CLOEXEC) == -1)) {
+        const int eno = errno;
+        qvi_log_error("pipe2() failed with errno={} ({})", eno, strerror(eno));
+        return QV_ERR_SYS;
+    }
     const pid_t pid = fork();
     // Fork failed.
     if (qvi_unlikely(pid == -1)) {
@@ -394,14 +664,22 @@ qvi_start_quo_vadisd(
                 "fork() failed while starting " + dname, qvi_maxolen
             )
         );
+        (void)close(ready_fds[0]);
+        (void)close(ready_fds[1]);
         return QV_ERR_SYS;
     }
     // Child
     else if (pid == 0) {
+        // Only the write end of the pipe survives the exec.
+        (void)close(ready_fds[0]);
+        (void)fcntl(ready_fds[1], F_SETFD, 0);
+
         std::vector<std::string> argss = {
             dname,
             "--port",
-            std::to_string(portno)
+            std::to_string(portno),
+            "--ready-fd",
+            std::to_string(ready_fds[1])
         };
 
         std::vector<char *> argv;
@@ -422,7 +700,15 @@ qvi_start_quo_vadisd(
         );
         _exit(EXIT_FAILURE);
     }
-    return QV_SUCCESS;
+    // Parent
+    (void)close(ready_fds[1]);
+    const int rc = wait_for_daemon_ready(ready_fds[0]);
+    (void)close(ready_fds[0]);
+    if (qvi_likely(rc == QV_SUCCESS)) return rc;
+    // Our daemon may have lost a race for the port to another one.
+    if (qvi_session_discover(0, portno) == QV_SUCCESS) return QV_SUCCESS;
+    qvi_log_error("{} exited before becoming ready", dname);
+    return rc;
 }
 
 static inline bool
@@ -113,6 +113,16 @@ public:
         value = it->second->second;
         return QV_SUCCESS;
     }
+
+    /**
+     * Removes all cached entries.
+     */
+    void
+    clear(void)
+    {
+        m_cache_map.clear();
+        m_cache_list.clear();
+    }
 };
 
 /**
@@ -213,6 +223,35 @@ qvi_access(
     int *errc
 );
 
+/**
+ * Returns whether the provided directory is private to the calling user: it
+ * must be ours and inaccessible to others. Creates it first, if requested.
+ */
+bool
+qvi_private_dir(
+    const std::string &path,
+    bool create
+);
+
+/**
+ * Returns the contents of the provided file or an empty string if it cannot be
+ * read.
+ */
+std::string
+qvi_read_file(
+    const std::string &path
+);
+
+/**
+ * Atomically replaces the contents of the provided file.
+ */
+int
+qvi_write_file_atomic(
+    const std::string &path,
+    const char *data,
+    size_t len
+);
+
 /**
  * Converts string to an int, if possible.
  */
@@ -271,6 +310,58 @@ qvi_rmall(
 std::string
 qvi_tmpdir(void);
 
+/**
+ * Returns the path to the session directory associated with the provided port.
+ */
+std::string
+qvi_session_dir(
+    int portno
+);
+
+/**
+ * Returns the path to the directory in which the server keeps data that
+ * outlive its sessions, such as topology snapshots. It is private to the
+ * calling user.
+ */
+std::string
+qvi_cache_dir(void);
+
+/**
+ * Returns the path to the record describing the session associated with the
+ * provided port. Records are private to the calling user.
+ */
+std::string
+qvi_session_record_path(
+    int portno
+);
+
+/**
+ * Publishes the record of the calling server's session, which lets clients
+ * find it without scanning /proc.
+ */
+int
+qvi_session_publish(
+    int portno
+);
+
+/**
+ * Removes the record published by qvi_session_publish().
+ */
+int
+qvi_session_unpublish(
+    int portno
+);
+
+/**
+ * Returns the path to the Unix-domain socket that serves as the RMI endpoint
+ * of the session associated with the provided port. Returns an empty string if
+ * the path is too long to be used as a Unix-domain socket address.
+ */
+std::string
+qvi_session_ipc_path(
+    int portno
+);
+
 /**
  *
  */
@@ -299,7 +390,8 @@ qvi_session_discover(
 );
 
 /**
- *
+ * Starts a daemon serving the provided port. Returns once it accepts
+ * connections, so callers can connect without polling for it.
  */
 int
 qvi_start_quo_vadisd(
@@ -0,0 +1,178 @@
+/* -*- Mode: C++; c-basic-offset:4; indent-tabs-mode:nil -*- */
+
+/**
+ * @file test-bitmap.cc
+ *
+ * Exercises qvi_hwloc_bitmap serialization. Verifies round trips through the
+ * binary wire encoding and compares its throughput against the string-based
+ * encoding (hwloc_bitmap_asprintf/hwloc_bitmap_sscanf) it replaced.
+ */
+
+#include "qvi-common.h" // IWYU pragma: keep
+#include "qvi-bbuff.h"
+#include "qvi-hwloc.h"
+
+#include "common-test-utils.h"
+
+static qvi_hwloc_bitmap
+gen_bitmap(
+    size_t nbits,
+    std::mt19937 &rng
+) {
+    qvi_hwloc_bitmap result;
+    std::bernoulli_distribution coin(0.5);
+    for (size_t i = 0; i < nbits; ++i) {
+        if (coin(rng)) hwloc_bitmap_set(result.data(), i);
+    }
+    return result;
+}
+
+static qvi_hwloc_bitmap
+round_trip(
+    const qvi_hwloc_bitmap &bitmap
+) {
+    qvi_bbuff buff;
+    int rc = buff.pack(bitmap);
+    ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+
+    qvi_hwloc_bitmap result;
+    rc = qvi_bbuff::unpack(buff.data(), result);
+    ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+    return result;
+}
+
+static void
+expect_round_trip(
+    const qvi_hwloc_bitmap &bitmap
+) {
+    const qvi_hwloc_bitmap result = round_trip(bitmap);
+    ctu_assert(
+        result == bitmap, "%s != %s",
+        qvi_hwloc::bitmap_string(result).c_str(),
+        qvi_hwloc::bitmap_string(bitmap).c_str()
+    );
+}
+
+// Round trips of special and irregular bitmaps.
+static void
+test_round_trip(void)
+{
+    std::mt19937 rng(42);
+    // Empty.
+    expect_round_trip(qvi_hwloc_bitmap());
+    // Single bits around word boundaries.
+    for (const int bit : {0, 1, 63, 64, 65, 127, 128, 1023, 4095}) {
+        qvi_hwloc_bitmap bitmap;
+        hwloc_bitmap_set(bitmap.data(), bit);
+        expect_round_trip(bitmap);
+    }
+    // Random, finite.
+    for (const size_t nbits : {8, 64, 100, 512, 4096, 16384}) {
+        expect_round_trip(gen_bitmap(nbits, rng));
+    }
+    // Full (infinite).
+    qvi_hwloc_bitmap full;
+    hwloc_bitmap_fill(full.data());
+    expect_round_trip(full);
+    // Infinite with holes.
+    for (const int hole : {0, 5, 64, 200}) {
+        qvi_hwloc_bitmap bitmap;
+        hwloc_bitmap_fill(bitmap.data());
+        hwloc_bitmap_clr(bitmap.data(), hole);
+        expect_round_trip(bitmap);
+    }
+    // Several bitmaps in one buffer.
+    {
+        const qvi_hwloc_bitmap a = gen_bitmap(256, rng);
+        const qvi_hwloc_bitmap b = gen_bitmap(1024, rng);
+        std::vector<qvi_hwloc_bitmap> vec = {a, b, a};
+
+        qvi_bbuff buff;
+        int rc = buff.pack(a, vec, b);
+        ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+
+        qvi_hwloc_bitmap ra, rb;
+        std::vector<qvi_hwloc_bitmap> rvec;
+        rc = qvi_bbuff::unpack(buff.data(), ra, rvec, rb);
+        ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+        ctu_assert(ra == a && rb == b, "unexpected result");
+        ctu_assert(rvec.size() == vec.size(), "unexpected size");
+        for (size_t i = 0; i < vec.size(); ++i) {
+            ctu_assert(rvec[i] == vec[i], "unexpected result");
+        }
+    }
+    qvi_log_info("✓ {} PASSED", __func__);
+}
+
+// Times round trips through the binary and string encodings.
+static void
+test_throughput(void)
+{
+    std::mt19937 rng(7);
+    const size_t niters = 2000;
+
+    printf("# %8s %10s %10s %14s %14s %8s\n",
+        "nbits", "bin(B)", "str(B)", "bin(us/rt)", "str(us/rt)", "speedup"
+    );
+    for (const size_t nbits : {64, 256, 1024, 4096, 16384}) {
+        const qvi_hwloc_bitmap bitmap = gen_bitmap(nbits, rng);
+        // Binary encoding.
+        size_t bin_bytes = 0;
+        const double bin_start = qvi_time();
+        for (size_t i = 0; i < niters; ++i) {
+            qvi_bbuff buff;
+            int rc = buff.pack(bitmap);
+            ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+            bin_bytes = buff.size();
+
+            qvi_hwloc_bitmap result;
+            rc = qvi_bbuff::unpack(buff.data(), result);
+            ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+        }
+        const double bin_time = qvi_time() - bin_start;
+        // String encoding.
+        size_t str_bytes = 0;
+        const double str_start = qvi_time();
+        for (size_t i = 0; i < niters; ++i) {
+            qvi_bbuff buff;
+            int rc = buff.pack(qvi_hwloc::bitmap_string(bitmap));
+            ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+            str_bytes = buff.size();
+
+            std::string bitmaps;
+            rc = qvi_bbuff::unpack(buff.data(), bitmaps);
+            ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+
+            qvi_hwloc_bitmap result;
+            rc = qvi_hwloc::bitmap_sscanf(
+                result.data(), const_cast<char *>(bitmaps.c_str())
+            );
+            ctu_assert(rc == QV_SUCCESS, "%d != QV_SUCCESS", rc);
+            ctu_assert(result == bitmap, "unexpected result");
+        }
+        const double str_time = qvi_time() - str_start;
+
+        const double bin_us = bin_time * 1e6 / niters;
+        const double str_us = str_time * 1e6 / niters;
+        printf("# %8zu %10zu %10zu %14.3lf %14.3lf %7.2lfx\n",
+            nbits, bin_bytes, str_bytes, bin_us, str_us,
+            (bin_us > 0.0) ? str_us / bin_us : 0.0
+        );
+    }
+    qvi_log_info("✓ {} PASSED", __func__);
+}
+
+int
+main(void)
+{
+    printf("\n# Starting bitmap test\n");
+
+    test_round_trip();
+    test_throughput();
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * vim: ft=cpp ts=4 sts=4 sw=4 expandtab
+ */
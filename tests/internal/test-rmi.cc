@@ -11,7 +11,9 @@
 
 static int
 server(
-    const char *url
+    const char *url,
+    size_t nworkers,
+    const char *sysfs_root
 ) {
     printf("# [%d] Starting Server (%s)\n", getpid(), url);
 
@@ -34,6 +36,8 @@ server(
     }
 
     config.url = std::string(url);
+    config.nworkers = nworkers;
+    if (sysfs_root) config.sysfs_root = sysfs_root;
 
     rc = hwloc.topology_export(qvi_tmpdir());
     if (rc != QV_SUCCESS) {
@@ -47,6 +51,12 @@ server(
         goto out;
     }
 
+    rc = server.topology_export(qvi_tmpdir());
+    if (rc != QV_SUCCESS) {
+        ers = "server.topology_export() failed";
+        goto out;
+    }
+
     rc = server.start();
     if (rc != QV_SUCCESS) {
         ers = "qvi_rmi_server_start() failed";
@@ -74,6 +84,340 @@ get_portno(
     return 0;
 }
 
+/**
+ * Verifies that batched operations produce the same results as their
+ * individually issued counterparts.
+ */
+static int
+batch(
+    qvi_rmi_client &client
+) {
+    const pid_t who = qvi_gettid();
+    std::vector<qv_hw_obj_type_t> types;
+    for (int i = QV_HW_OBJ_MACHINE; i < QV_HW_OBJ_LAST; ++i) {
+        types.push_back(qv_hw_obj_type_t(i));
+    }
+    // Individually.
+    qvi_hwloc_bitmap bitmap;
+    int rc = client.get_cpubind(who, bitmap);
+    if (rc != QV_SUCCESS) return rc;
+
+    int depth = 0;
+    rc = client.get_obj_depth(QV_HW_OBJ_CORE, depth);
+    if (rc != QV_SUCCESS) return rc;
+
+    std::vector<size_t> nobjs;
+    rc = client.get_nobjs_in_cpuset(types, bitmap, nobjs);
+    if (rc != QV_SUCCESS) return rc;
+    // Batched. Note that topology queries are answered locally when issued
+    // individually, so this also checks that they agree with the server.
+    qvi_hwloc_bitmap bbitmap;
+    int bdepth = 0;
+    std::vector<size_t> bnobjs(types.size());
+    qvi_rmi_batch batch(client);
+    rc = batch.get_cpubind(who, bbitmap);
+    if (rc != QV_SUCCESS) return rc;
+    rc = batch.get_obj_depth(QV_HW_OBJ_CORE, bdepth);
+    if (rc != QV_SUCCESS) return rc;
+    for (size_t i = 0; i < types.size(); ++i) {
+        rc = batch.get_nobjs_in_cpuset(types[i], bitmap, bnobjs[i]);
+        if (rc != QV_SUCCESS) return rc;
+    }
+    rc = batch.execute();
+    if (rc != QV_SUCCESS) return rc;
+
+    if (bitmap != bbitmap || depth != bdepth || nobjs != bnobjs) {
+        return QV_ERR_INTERNAL;
+    }
+    printf("# [%d] batched %zu operations\n", who, types.size() + 2);
+    return QV_SUCCESS;
+}
+
+/**
+ * Verifies that several RPCs can be in flight at once and that their results
+ * can be collected in any order.
+ */
+static int
+pipeline(
+    qvi_rmi_client &client
+) {
+    const pid_t who = qvi_gettid();
+    const size_t nrpcs = 16;
+
+    qvi_hwloc_bitmap bitmap;
+    int rc = client.get_cpubind(who, bitmap);
+    if (rc != QV_SUCCESS) return rc;
+
+    size_t npus = 0;
+    rc = client.get_nobjs_in_cpuset(QV_HW_OBJ_PU, bitmap, npus);
+    if (rc != QV_SUCCESS) return rc;
+
+    std::vector<qvi_hwloc_bitmap> bitmaps(nrpcs);
+    std::vector<size_t> nobjs(nrpcs);
+    std::vector<qvi_rmi_future> bfutures(nrpcs);
+    std::vector<qvi_rmi_future> nfutures(nrpcs);
+    for (size_t i = 0; i < nrpcs; ++i) {
+        rc = client.get_cpubind_async(who, bitmaps[i], bfutures[i]);
+        if (rc != QV_SUCCESS) return rc;
+        rc = client.get_nobjs_in_cpuset_async(
+            QV_HW_OBJ_PU, bitmap, nobjs[i], nfutures[i]
+        );
+        if (rc != QV_SUCCESS) return rc;
+    }
+    // A blocking call in between must not steal another's reply.
+    int depth = 0;
+    rc = client.get_obj_depth(QV_HW_OBJ_PU, depth);
+    if (rc != QV_SUCCESS) return rc;
+    // Discard one result without waiting on it.
+    qvi_hwloc_bitmap unused;
+    {
+        qvi_rmi_future future;
+        rc = client.get_cpubind_async(who, unused, future);
+        if (rc != QV_SUCCESS) return rc;
+    }
+    // Collect in reverse order.
+    for (size_t i = nrpcs; i-- > 0;) {
+        rc = nfutures[i].wait();
+        if (rc != QV_SUCCESS) return rc;
+        rc = bfutures[i].wait();
+        if (rc != QV_SUCCESS) return rc;
+        if (bitmaps[i] != bitmap || nobjs[i] != npus) return QV_ERR_INTERNAL;
+    }
+    printf("# [%d] pipelined %zu operations\n", who, 2 * nrpcs);
+    return QV_SUCCESS;
+}
+
+/**
+ * Verifies that identical queries in flight at once, or repeated later, all
+ * get the same answer when the server shares replies among them.
+ */
+static int
+shared_replies(
+    qvi_rmi_client &client
+) {
+    const pid_t who = qvi_gettid();
+    const size_t nrpcs = 16;
+
+    qvi_hwpool hwpool;
+    int rc = client.get_intrinsic_hwpool(
+        {who}, QV_SCOPE_USER, QV_SCOPE_FLAG_NONE, hwpool
+    );
+    if (rc != QV_SUCCESS) return rc;
+
+    std::vector<qvi_hwpool> hwpools(nrpcs);
+    std::vector<qvi_rmi_future> futures(nrpcs);
+    for (size_t i = 0; i < nrpcs; ++i) {
+        rc = client.get_intrinsic_hwpool_async(
+            {who}, QV_SCOPE_USER, QV_SCOPE_FLAG_NONE, hwpools[i], futures[i]
+        );
+        if (rc != QV_SUCCESS) return rc;
+    }
+    for (size_t i = 0; i < nrpcs; ++i) {
+        rc = futures[i].wait();
+        if (rc != QV_SUCCESS) return rc;
+        if (hwpools[i].cpuset() != hwpool.cpuset()) return QV_ERR_INTERNAL;
+    }
+    // Process pools are only shared by requests in flight.
+    qvi_hwpool phwpool;
+    rc = client.get_intrinsic_hwpool(
+        {who}, QV_SCOPE_PROCESS, QV_SCOPE_FLAG_NONE, phwpool
+    );
+    if (rc != QV_SUCCESS) return rc;
+
+    qvi_hwloc_bitmap bitmap;
+    rc = client.get_cpubind(who, bitmap);
+    if (rc != QV_SUCCESS) return rc;
+    if (phwpool.cpuset() != bitmap) return QV_ERR_INTERNAL;
+    // The same query several times in one batch.
+    std::vector<size_t> nobjs(nrpcs);
+    qvi_rmi_batch batch(client);
+    for (size_t i = 0; i < nrpcs; ++i) {
+        rc = batch.get_nobjs_in_cpuset(QV_HW_OBJ_PU, bitmap, nobjs[i]);
+        if (rc != QV_SUCCESS) return rc;
+    }
+    rc = batch.execute();
+    if (rc != QV_SUCCESS) return rc;
+
+    size_t npus = 0;
+    rc = client.get_nobjs_in_cpuset(QV_HW_OBJ_PU, bitmap, npus);
+    if (rc != QV_SUCCESS) return rc;
+    for (const size_t n : nobjs) {
+        if (n != npus) return QV_ERR_INTERNAL;
+    }
+    printf("# [%d] shared %zu replies\n", who, 2 * nrpcs);
+    return QV_SUCCESS;
+}
+
+/**
+ * Verifies that repeated queries are answered from the client's cache.
+ */
+static int
+cached_queries(
+    qvi_rmi_client &client
+) {
+    const pid_t who = qvi_gettid();
+    const size_t nrpcs = 8;
+
+    std::vector<qvi_rmi_rpc_stats> before, after;
+    int rc = client.get_stats(before);
+    if (rc != QV_SUCCESS) return rc;
+
+    qvi_hwpool hwpool;
+    rc = client.get_intrinsic_hwpool(
+        {who}, QV_SCOPE_USER, QV_SCOPE_FLAG_NONE, hwpool
+    );
+    if (rc != QV_SUCCESS) return rc;
+    for (size_t i = 0; i < nrpcs; ++i) {
+        qvi_hwpool cached;
+        rc = client.get_intrinsic_hwpool(
+            {who}, QV_SCOPE_USER, QV_SCOPE_FLAG_NONE, cached
+        );
+        if (rc != QV_SUCCESS) return rc;
+        if (cached.cpuset() != hwpool.cpuset()) return QV_ERR_INTERNAL;
+    }
+
+    rc = client.get_stats(after);
+    if (rc != QV_SUCCESS) return rc;
+    // At most the first query reached the server.
+    const qvi_rmi_rpc_fid_t fid = QVI_RMI_FID_GET_INTRINSIC_HWPOOL;
+    if (after[fid].count - before[fid].count > 1) return QV_ERR_INTERNAL;
+
+    printf("# [%d] cached %zu queries\n", who, nrpcs);
+    return QV_SUCCESS;
+}
+
+/**
+ * Verifies that reserved resources are not handed out again until released.
+ */
+static int
+leases(
+    qvi_rmi_client &client
+) {
+    const pid_t who = qvi_gettid();
+
+    qvi_hwloc_bitmap bitmap;
+    int rc = client.get_cpubind(who, bitmap);
+    if (rc != QV_SUCCESS) return rc;
+
+    size_t npus = 0;
+    rc = client.get_nobjs_in_cpuset(QV_HW_OBJ_PU, bitmap, npus);
+    if (rc != QV_SUCCESS) return rc;
+    // Reserve every PU, one at a time.
+    std::vector<uint64_t> ids(npus);
+    qvi_hwloc_bitmap reserved;
+    for (size_t i = 0; i < npus; ++i) {
+        qvi_hwpool hwpool;
+        rc = client.reserve(bitmap, QV_HW_OBJ_PU, 1, ids[i], hwpool);
+        if (rc != QV_SUCCESS) return rc;
+        if (hwloc_bitmap_intersects(
+                reserved.cdata(), hwpool.cpuset().cdata())) {
+            return QV_ERR_INTERNAL;
+        }
+        hwloc_bitmap_or(
+            reserved.data(), reserved.cdata(), hwpool.cpuset().cdata()
+        );
+    }
+    if (reserved != bitmap) return QV_ERR_INTERNAL;
+    // Nothing is left.
+    uint64_t id = 0;
+    qvi_hwpool hwpool;
+    rc = client.reserve(bitmap, QV_HW_OBJ_PU, 1, id, hwpool);
+    if (rc != QV_RES_UNAVAILABLE) return QV_ERR_INTERNAL;
+    // Until something is released.
+    rc = client.release(ids[0]);
+    if (rc != QV_SUCCESS) return rc;
+    rc = client.reserve(bitmap, QV_HW_OBJ_PU, 1, ids[0], hwpool);
+    if (rc != QV_SUCCESS) return rc;
+    for (const uint64_t lid : ids) {
+        rc = client.release(lid);
+        if (rc != QV_SUCCESS) return rc;
+    }
+    // Leases can only be released once.
+    rc = client.release(ids[0]);
+    if (rc != QV_ERR_NOT_FOUND) return QV_ERR_INTERNAL;
+
+    printf("# [%d] leased %zu PUs\n", who, npus);
+    return QV_SUCCESS;
+}
+
+/**
+ * Verifies that several tasks can be bound in a single request, both
+ * explicitly and by concurrent threads whose requests are combined.
+ */
+static int
+bind_many(
+    qvi_rmi_client &client
+) {
+    const pid_t who = qvi_gettid();
+    const size_t nthreads = 8;
+
+    qvi_hwloc_bitmap bitmap;
+    int rc = client.get_cpubind(who, bitmap);
+    if (rc != QV_SUCCESS) return rc;
+    // Concurrently.
+    std::vector<int> rcs(nthreads, QV_ERR);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nthreads; ++i) {
+        threads.emplace_back([&, i] {
+            rcs[i] = client.set_cpubind(qvi_gettid(), bitmap);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (const int trc : rcs) {
+        if (trc != QV_SUCCESS) return trc;
+    }
+    // Explicitly.
+    const std::vector<pid_t> tids(nthreads, who);
+    const std::vector<qvi_hwloc_bitmap> cpusets(nthreads, bitmap);
+    rc = client.set_cpubind(tids, cpusets);
+    if (rc != QV_SUCCESS) return rc;
+    // Mismatched tasks and cpusets are rejected.
+    rc = client.set_cpubind(tids, {bitmap});
+    if (rc != QV_ERR_INVLD_ARG) return QV_ERR_INTERNAL;
+
+    qvi_hwloc_bitmap result;
+    rc = client.get_cpubind(who, result);
+    if (rc != QV_SUCCESS) return rc;
+    if (result != bitmap) return QV_ERR_INTERNAL;
+
+    printf("# [%d] bound %zu tasks in bulk\n", who, 2 * nthreads);
+    return QV_SUCCESS;
+}
+
+/**
+ * Verifies that the server accounts for the RPCs issued so far.
+ */
+static int
+stats(
+    qvi_rmi_client &client
+) {
+    std::vector<qvi_rmi_rpc_stats> stats;
+    int rc = client.get_stats(stats);
+    if (rc != QV_SUCCESS) return rc;
+    if (stats.size() != QVI_RMI_FID_LAST) return QV_ERR_INTERNAL;
+
+    for (const auto fid : {QVI_RMI_FID_HELLO, QVI_RMI_FID_GET_CPUBIND}) {
+        const qvi_rmi_rpc_stats &fstats = stats[fid];
+        const uint64_t nhist = std::accumulate(
+            fstats.handler_hist.begin(), fstats.handler_hist.end(), uint64_t(0)
+        );
+        if (fstats.count == 0 || nhist != fstats.count) {
+            return QV_ERR_INTERNAL;
+        }
+        if (fstats.bytes_in == 0 || fstats.bytes_out == 0) {
+            return QV_ERR_INTERNAL;
+        }
+        printf(
+            "# [%d] %s: %" PRIu64 " requests, %.3lf us/request\n",
+            qvi_gettid(), qvi_rmi_rpc_fid_name(fid), fstats.count,
+            fstats.handler_ns / 1e3 / fstats.count
+        );
+    }
+    return QV_SUCCESS;
+}
+
 static int
 client(
     char *url,
@@ -115,6 +459,48 @@ client(
     res = qvi_hwloc::bitmap_string(bitmap);
     printf("# [%d] cpubind = %s\n", who, res.c_str());
 
+    rc = batch(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "batch() failed";
+        goto out;
+    }
+
+    rc = pipeline(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "pipeline() failed";
+        goto out;
+    }
+
+    rc = shared_replies(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "shared_replies() failed";
+        goto out;
+    }
+
+    rc = cached_queries(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "cached_queries() failed";
+        goto out;
+    }
+
+    rc = leases(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "leases() failed";
+        goto out;
+    }
+
+    rc = bind_many(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "bind_many() failed";
+        goto out;
+    }
+
+    rc = stats(*client);
+    if (rc != QV_SUCCESS) {
+        ers = "stats() failed";
+        goto out;
+    }
+
     if (send_shutdown_msg) {
         rc = client->send_shutdown_message();
     }
@@ -127,10 +513,273 @@ out:
     return 0;
 }
 
+/**
+ * Exercises a multi-worker server with concurrent clients, each repeatedly
+ * setting and getting its own binding. Shuts the server down when done.
+ */
+static int
+concurrent_clients(
+    char *url,
+    size_t nclients
+) {
+    printf(
+        "# [%d] Starting %zu Concurrent Clients (%s)\n",
+        getpid(), nclients, url
+    );
+
+    int portno = 0;
+    if (get_portno(url, &portno) != 0) {
+        fprintf(stderr, "\nget_portno() failed\n");
+        return 1;
+    }
+
+    std::atomic<int> nfailed = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nclients; ++i) {
+        threads.emplace_back([&]() {
+            qvi_rmi_client client;
+            const pid_t who = qvi_gettid();
+            qvi_hwloc_bitmap orig, bitmap;
+
+            int rc = client.connect(QV_SCOPE_FLAG_NONE, url, portno);
+            if (rc == QV_SUCCESS) rc = client.get_cpubind(who, orig);
+            for (int j = 0; j < 64 && rc == QV_SUCCESS; ++j) {
+                rc = client.set_cpubind(who, orig);
+                if (rc != QV_SUCCESS) break;
+                rc = client.get_cpubind(who, bitmap);
+                if (rc != QV_SUCCESS) break;
+                if (!hwloc_bitmap_isequal(orig.cdata(), bitmap.cdata())) {
+                    rc = QV_ERR_INTERNAL;
+                }
+            }
+            if (rc == QV_SUCCESS) rc = pipeline(client);
+            if (rc == QV_SUCCESS) rc = shared_replies(client);
+            if (rc != QV_SUCCESS) {
+                fprintf(
+                    stderr, "\n[%d] client failed (rc=%d, %s)\n",
+                    who, rc, qv_strerr(rc)
+                );
+                nfailed++;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    printf(
+        "# [%d] Concurrent Clients Done (%d failed)\n",
+        getpid(), nfailed.load()
+    );
+    // Tell the server we are done, regardless of outcome.
+    const int rc = client(url, true);
+    return (nfailed == 0 && rc == 0) ? 0 : 1;
+}
+
+/**
+ * Compares the latency of binding push/pop pairs made through the server with
+ * that of ones the calling thread makes directly. Shuts the server down when
+ * done.
+ */
+static int
+bind_latency(
+    char *url
+) {
+    printf("# [%d] Starting Bind Latency Benchmark (%s)\n", getpid(), url);
+
+    int portno = 0;
+    if (get_portno(url, &portno) != 0) {
+        fprintf(stderr, "\nget_portno() failed\n");
+        return 1;
+    }
+
+    const pid_t who = qvi_gettid();
+    const size_t niters = 1000;
+    qvi_rmi_client client;
+    qvi_hwloc_bitmap orig, pushed, bitmap;
+
+    int rc = client.connect(QV_SCOPE_FLAG_NONE, url, portno);
+    if (rc == QV_SUCCESS) rc = client.get_my_cpubind(orig);
+    // Push a binding to the first PU of our current binding.
+    if (rc == QV_SUCCESS) {
+        rc = client.get_cpuset_for_nobjs(orig, QV_HW_OBJ_PU, 1, pushed);
+    }
+    if (rc != QV_SUCCESS) {
+        fprintf(stderr, "\nsetup failed (rc=%d, %s)\n", rc, qv_strerr(rc));
+        (void)client.send_shutdown_message();
+        return 1;
+    }
+    printf(
+        "# [%d] topology is this system: %s\n",
+        who, client.hwloc()->topology_is_this_system() ? "yes" : "no"
+    );
+    // Through the server.
+    const double rpc_start = qvi_time();
+    for (size_t i = 0; i < niters && rc == QV_SUCCESS; ++i) {
+        rc = client.set_cpubind(who, pushed);
+        if (rc == QV_SUCCESS) rc = client.set_cpubind(who, orig);
+    }
+    const double rpc_time = qvi_time() - rpc_start;
+    // Directly, when possible.
+    const double self_start = qvi_time();
+    for (size_t i = 0; i < niters && rc == QV_SUCCESS; ++i) {
+        rc = client.set_my_cpubind(pushed);
+        if (rc == QV_SUCCESS) rc = client.set_my_cpubind(orig);
+    }
+    const double self_time = qvi_time() - self_start;
+    // Make sure the direct binds took effect.
+    if (rc == QV_SUCCESS) rc = client.set_my_cpubind(pushed);
+    if (rc == QV_SUCCESS) rc = client.get_cpubind(who, bitmap);
+    if (rc == QV_SUCCESS && bitmap != pushed) rc = QV_ERR_INTERNAL;
+    if (rc == QV_SUCCESS) rc = client.set_my_cpubind(orig);
+
+    const int src = client.send_shutdown_message();
+    if (rc != QV_SUCCESS || src != QV_SUCCESS) {
+        if (rc == QV_SUCCESS) rc = src;
+        fprintf(stderr, "\nbinding failed (rc=%d, %s)\n", rc, qv_strerr(rc));
+        return 1;
+    }
+
+    const double rpc_us = rpc_time * 1e6 / niters;
+    const double self_us = self_time * 1e6 / niters;
+    printf("# %14s %14s %8s\n", "rpc(us/pp)", "self(us/pp)", "speedup");
+    printf("# %14.3lf %14.3lf %7.2lfx\n",
+        rpc_us, self_us, (self_us > 0.0) ? rpc_us / self_us : 0.0
+    );
+    return 0;
+}
+
+/**
+ * Waits for the server to hand out the expected user hardware pool, then
+ * checks that the client topology allows the same PUs. If busy, also sends the
+ * server an uncached request in between, so that it never goes idle.
+ */
+static int
+await_user_cpuset(
+    qvi_rmi_client &client,
+    const qvi_hwloc_bitmap &expected,
+    bool busy = false
+) {
+    const pid_t who = qvi_gettid();
+    for (size_t i = 0; i < 1000; ++i) {
+        if (busy) {
+            qvi_hwloc_bitmap cpuset;
+            const int rc = client.get_cpubind(who, cpuset);
+            if (rc != QV_SUCCESS) return rc;
+        }
+        qvi_hwpool hwpool;
+        const int rc = client.get_intrinsic_hwpool(
+            {who}, QV_SCOPE_USER, QV_SCOPE_FLAG_NONE, hwpool
+        );
+        if (rc != QV_SUCCESS) return rc;
+        if (hwpool.cpuset() != expected) {
+            usleep(10000);
+            continue;
+        }
+        // By now, the client must have picked up the matching topology.
+        const qvi_hwloc_bitmap allowed(client.hwloc()->topology_get_cpuset());
+        if (allowed == expected) return QV_SUCCESS;
+        fprintf(
+            stderr, "\nClient topology allows %s, not %s\n",
+            qvi_hwloc::bitmap_list_string(allowed.cdata()).c_str(),
+            qvi_hwloc::bitmap_list_string(expected.cdata()).c_str()
+        );
+        return QV_ERR_INTERNAL;
+    }
+    return QV_ERR_INTERNAL;
+}
+
+/**
+ * Takes all but the first PU offline in the fake sysfs tree under the provided
+ * root, which the server must also use, then brings them back, verifying that
+ * the server follows. Then takes them offline again without the server being
+ * notified, while keeping it busy. Shuts the server down when done.
+ */
+static int
+hotplug(
+    char *url,
+    const char *root
+) {
+    printf("# [%d] Starting Hotplug Test (%s)\n", getpid(), url);
+
+    if (!root) {
+        fprintf(stderr, "\nNo sysfs root provided\n");
+        return 1;
+    }
+    const std::string online =
+        std::string(root) + "/sys/devices/system/cpu/online";
+
+    int portno = 0;
+    if (get_portno(url, &portno) != 0) {
+        fprintf(stderr, "\nget_portno() failed\n");
+        return 1;
+    }
+
+    const pid_t who = qvi_gettid();
+    qvi_rmi_client client;
+    qvi_hwpool hwpool;
+    qvi_hwloc_bitmap first;
+    std::string list;
+
+    int rc = client.connect(QV_SCOPE_FLAG_NONE, url, portno);
+    if (rc == QV_SUCCESS) {
+        rc = client.get_intrinsic_hwpool(
+            {who}, QV_SCOPE_USER, QV_SCOPE_FLAG_NONE, hwpool
+        );
+    }
+    const qvi_hwloc_bitmap &all = hwpool.cpuset();
+    // Replace the file, then modify it in place.
+    if (rc == QV_SUCCESS) {
+        hwloc_bitmap_only(first.data(), hwloc_bitmap_first(all.cdata()));
+        list = qvi_hwloc::bitmap_list_string(first.cdata()) + "\n";
+        rc = qvi_write_file_atomic(online, list.c_str(), list.size());
+    }
+    if (rc == QV_SUCCESS) rc = await_user_cpuset(client, first);
+    if (rc == QV_SUCCESS) {
+        printf("# [%d] offline: %s", who, list.c_str());
+        list = qvi_hwloc::bitmap_list_string(all.cdata()) + "\n";
+        std::ofstream out(online, std::ios::trunc);
+        out << list;
+        out.close();
+        if (!out) rc = QV_ERR_FILE_IO;
+    }
+    if (rc == QV_SUCCESS) rc = await_user_cpuset(client, all);
+    if (rc == QV_SUCCESS) printf("# [%d] online: %s", who, list.c_str());
+    // Like sysfs, changes to the file behind this link raise no events in the
+    // directory the server watches.
+    const std::string hidden = std::string(root) + "/online";
+    if (rc == QV_SUCCESS) {
+        rc = qvi_write_file_atomic(hidden, list.c_str(), list.size());
+    }
+    if (rc == QV_SUCCESS) {
+        const std::string link = online + ".link";
+        (void)unlink(link.c_str());
+        if (symlink(hidden.c_str(), link.c_str()) != 0 ||
+            rename(link.c_str(), online.c_str()) != 0) {
+            rc = QV_ERR_FILE_IO;
+        }
+    }
+    if (rc == QV_SUCCESS) {
+        list = qvi_hwloc::bitmap_list_string(first.cdata()) + "\n";
+        rc = qvi_write_file_atomic(hidden, list.c_str(), list.size());
+    }
+    if (rc == QV_SUCCESS) rc = await_user_cpuset(client, first, true);
+    if (rc == QV_SUCCESS) printf("# [%d] offline: %s", who, list.c_str());
+
+    const int src = client.send_shutdown_message();
+    if (rc != QV_SUCCESS || src != QV_SUCCESS) {
+        if (rc == QV_SUCCESS) rc = src;
+        fprintf(stderr, "\nhotplug failed (rc=%d, %s)\n", rc, qv_strerr(rc));
+        return 1;
+    }
+    return 0;
+}
+
 static void
 usage(const char *appn)
 {
-    fprintf(stderr, "Usage: %s URL -s|-c\n", appn);
+    fprintf(
+        stderr, "Usage: %s URL -s|-sm|-c|-cc|-cm|-cb|-ch [SYSFS_ROOT]\n", appn
+    );
 }
 
 int
@@ -142,12 +791,17 @@ main(
 
     setbuf(stdout, nullptr);
 
-    if (argc != 3) {
+    if (argc != 3 && argc != 4) {
         usage(argv[0]);
         return EXIT_FAILURE;
     }
+    // Where to fake changes to the PUs we may use.
+    const char *sysfs_root = (argc == 4) ? argv[3] : nullptr;
     if (strcmp(argv[2], "-s") == 0) {
-        rc = server(argv[1]);
+        rc = server(argv[1], 1, sysfs_root);
+    }
+    else if (strcmp(argv[2], "-sm") == 0) {
+        rc = server(argv[1], 4, sysfs_root);
     }
     else if (strcmp(argv[2], "-c") == 0) {
         rc = client(argv[1], false);
@@ -155,6 +809,15 @@ main(
     else if (strcmp(argv[2], "-cc") == 0) {
         rc = client(argv[1], true);
     }
+    else if (strcmp(argv[2], "-cm") == 0) {
+        rc = concurrent_clients(argv[1], 8);
+    }
+    else if (strcmp(argv[2], "-cb") == 0) {
+        rc = bind_latency(argv[1]);
+    }
+    else if (strcmp(argv[2], "-ch") == 0) {
+        rc = hotplug(argv[1], sysfs_root);
+    }
     else {
         usage(argv[0]);
         return EXIT_FAILURE;